@@ -0,0 +1,116 @@
+/*
+ * Semaphore contention benchmark. N producers SemV and M consumers SemP,
+ * either all on one semaphore or, with N == M, producer and consumer i
+ * on semaphore i. Every producer makes ITEMS items and the consumers
+ * share them evenly.
+ *
+ * Output lines are machine-readable:
+ *   BENCH semcontention producers=<n> consumers=<m> sems=<s> items=<total>
+ *         total_us=<t> items_per_ms=<1000*total/t>
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ITEMS   1000
+#define MAXSIDE 8
+
+int Producer(char *);
+int Consumer(char *);
+
+int sems[MAXSIDE];
+int numSems;
+int perConsumer;
+
+struct config {
+    int producers;
+    int consumers;
+    int sems;
+} configs[] = {
+    {1, 1, 1}, {1, 4, 1}, {4, 1, 1}, {4, 4, 1}, {8, 8, 1},
+    {4, 4, 4}, {8, 8, 8},
+};
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+int start3(char *arg)
+{
+    int pid;
+    int status;
+    int c, i;
+    int start, end;
+    char buf[20];
+
+    USLOSS_Console("start3(): started\n");
+
+    for (c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+        struct config *cfg = &configs[c];
+        int total = cfg->producers * ITEMS;
+
+        numSems = cfg->sems;
+        perConsumer = total / cfg->consumers;
+        for (i = 0; i < numSems; i++)
+            SemCreate(0, &sems[i]);
+
+        GetTimeofDay(&start);
+        for (i = 0; i < cfg->consumers; i++) {
+            sprintf(buf, "%d", i);
+            Spawn("Consumer", Consumer, buf, USLOSS_MIN_STACK, 4, &pid);
+        }
+        for (i = 0; i < cfg->producers; i++) {
+            sprintf(buf, "%d", i);
+            Spawn("Producer", Producer, buf, USLOSS_MIN_STACK, 4, &pid);
+        }
+        for (i = 0; i < cfg->producers + cfg->consumers; i++)
+            Wait(&pid, &status);
+        GetTimeofDay(&end);
+
+        for (i = 0; i < numSems; i++)
+            SemFree(sems[i]);
+
+        USLOSS_Console("BENCH semcontention producers=%d consumers=%d sems=%d items=%d "
+                       "total_us=%d items_per_ms=%d\n",
+                       cfg->producers, cfg->consumers, cfg->sems, total,
+                       end - start, end > start ? (int) (1000LL * total / (end - start)) : 0);
+    }
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+
+    return 0;
+} /* start3 */
+
+int Producer(char *arg)
+{
+    int sem = sems[atoi(arg) % numSems];
+    int i;
+
+    for (i = 0; i < ITEMS; i++)
+        SemV(sem);
+    Terminate(0);
+
+    return 0;
+} /* Producer */
+
+int Consumer(char *arg)
+{
+    int sem = sems[atoi(arg) % numSems];
+    int i;
+
+    for (i = 0; i < perConsumer; i++)
+        SemP(sem);
+    Terminate(0);
+
+    return 0;
+} /* Consumer */
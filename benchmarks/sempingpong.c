@@ -0,0 +1,94 @@
+/*
+ * Semaphore ping-pong benchmark. Two procs hand control back and forth
+ * through a pair of semaphores; each round trip is two SemV/SemP pairs
+ * and two context switches.
+ *
+ * Output lines are machine-readable:
+ *   BENCH sempingpong rounds=<n> total_us=<t> per_round_ns=<1000*t/n> cpu_us=<c>
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+#include <stdio.h>
+
+#define MAXROUNDS 10000
+
+int Ping(char *);
+int Pong(char *);
+
+int pingSem;
+int pongSem;
+int rounds;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+int start3(char *arg)
+{
+    int pid;
+    int status;
+
+    USLOSS_Console("start3(): started\n");
+
+    SemCreate(0, &pingSem);
+    SemCreate(0, &pongSem);
+
+    for (rounds = 100; rounds <= MAXROUNDS; rounds *= 10) {
+        Spawn("Pong", Pong, NULL, USLOSS_MIN_STACK, 4, &pid);
+        Spawn("Ping", Ping, NULL, USLOSS_MIN_STACK, 4, &pid);
+        Wait(&pid, &status);
+        Wait(&pid, &status);
+    }
+
+    SemFree(pingSem);
+    SemFree(pongSem);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+
+    return 0;
+} /* start3 */
+
+int Ping(char *arg)
+{
+    int i;
+    int start, end;
+    int cpuStart, cpuEnd;
+
+    GetTimeofDay(&start);
+    CPUTime(&cpuStart);
+    for (i = 0; i < rounds; i++) {
+        SemV(pingSem);
+        SemP(pongSem);
+    }
+    CPUTime(&cpuEnd);
+    GetTimeofDay(&end);
+
+    USLOSS_Console("BENCH sempingpong rounds=%d total_us=%d per_round_ns=%d cpu_us=%d\n",
+                   rounds, end - start, (int) (1000LL * (end - start) / rounds),
+                   cpuEnd - cpuStart);
+    Terminate(0);
+
+    return 0;
+} /* Ping */
+
+int Pong(char *arg)
+{
+    int i;
+
+    for (i = 0; i < rounds; i++) {
+        SemP(pingSem);
+        SemV(pongSem);
+    }
+    Terminate(0);
+
+    return 0;
+} /* Pong */
@@ -0,0 +1,105 @@
+/*
+ * Spawn/Wait scaling benchmark. Spawns trees of increasing size, up to
+ * as many processes as phase1 has room for, and reports the cost of
+ * building and reaping each tree per process.
+ *
+ * Output lines are machine-readable:
+ *   BENCH spawnscale procs=<n> total_us=<t> per_proc_us=<t/n> cpu_us=<c>
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAXTREE (MAXPROC - 4) /* all phase1 slots but sentinel, start1, start2 and start3 */
+
+int Node(char *);
+void runTree(int size);
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+int start3(char *arg)
+{
+    int size;
+
+    USLOSS_Console("start3(): started\n");
+
+    for (size = 1; size <= MAXTREE; size *= 2) {
+        runTree(size);
+    }
+    if (size / 2 < MAXTREE) {
+        runTree(MAXTREE);
+    }
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+
+    return 0;
+} /* start3 */
+
+/*
+ * Builds and reaps one tree of the given size and prints its BENCH line.
+ */
+void runTree(int size)
+{
+    int pid;
+    int status;
+    int start, end;
+    int cpuStart, cpuEnd;
+    char buf[20];
+
+    sprintf(buf, "%d", size);
+
+    GetTimeofDay(&start);
+    CPUTime(&cpuStart);
+    Spawn("Node", Node, buf, USLOSS_MIN_STACK, 3, &pid);
+    Wait(&pid, &status);
+    CPUTime(&cpuEnd);
+    GetTimeofDay(&end);
+
+    USLOSS_Console("BENCH spawnscale procs=%d total_us=%d per_proc_us=%d cpu_us=%d\n",
+                   size, end - start, (end - start) / size, cpuEnd - cpuStart);
+} /* runTree */
+
+/*
+ * Root of a subtree of the given size. Splits the rest of the subtree
+ * between two children and waits for both.
+ */
+int Node(char *arg)
+{
+    int size = atoi(arg);
+    int left = (size - 1) / 2;
+    int right = size - 1 - left;
+    int pid;
+    int status;
+    char buf[20];
+
+    if (left > 0) {
+        sprintf(buf, "%d", left);
+        Spawn("Node", Node, buf, USLOSS_MIN_STACK, 3, &pid);
+    }
+    if (right > 0) {
+        sprintf(buf, "%d", right);
+        Spawn("Node", Node, buf, USLOSS_MIN_STACK, 3, &pid);
+    }
+    if (left > 0) {
+        Wait(&pid, &status);
+    }
+    if (right > 0) {
+        Wait(&pid, &status);
+    }
+
+    Terminate(0);
+
+    return 0;
+} /* Node */
@@ -0,0 +1,170 @@
+/*
+ * Spawn/Wait/Terminate benchmark suite. Covers the paths through
+ * spawnReal, waitReal and terminateReal:
+ *   null     - Spawn and Wait for a child that returns at once, in a loop
+ *   deep     - a chain of n procs, each spawning and waiting for the next
+ *   wide     - one proc spawning n children, then waiting for all of them
+ *   killkids - a proc with n children blocked in SemP calling Terminate,
+ *              timed from the Terminate to its parent's Wait returning
+ *
+ * Output lines are machine-readable:
+ *   BENCH spawnwait op=<op> n=<n> total_us=<t> per_op_us=<t/n> cpu_us=<c>
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NULLITERS 500
+#define MAXFANOUT 40    /* stays under MAXPROC with start3 and the kernel procs */
+
+int Null(char *);
+int Chain(char *);
+int Fan(char *);
+int Blocker(char *);
+int Killer(char *);
+
+int blockSem;
+int killStart;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+static void report(char *op, int n, int start, int end, int cpu)
+{
+    USLOSS_Console("BENCH spawnwait op=%s n=%d total_us=%d per_op_us=%d cpu_us=%d\n",
+                   op, n, end - start, (end - start) / n, cpu);
+}
+
+int start3(char *arg)
+{
+    int pid;
+    int status;
+    int i, n;
+    int start, end;
+    int cpuStart, cpuEnd;
+    char buf[20];
+
+    USLOSS_Console("start3(): started\n");
+
+    GetTimeofDay(&start);
+    CPUTime(&cpuStart);
+    for (i = 0; i < NULLITERS; i++) {
+        Spawn("Null", Null, NULL, USLOSS_MIN_STACK, 3, &pid);
+        Wait(&pid, &status);
+    }
+    CPUTime(&cpuEnd);
+    GetTimeofDay(&end);
+    report("null", NULLITERS, start, end, cpuEnd - cpuStart);
+
+    for (n = 10; n <= MAXFANOUT; n += 10) {
+        sprintf(buf, "%d", n);
+
+        GetTimeofDay(&start);
+        CPUTime(&cpuStart);
+        Spawn("Chain", Chain, buf, USLOSS_MIN_STACK, 3, &pid);
+        Wait(&pid, &status);
+        CPUTime(&cpuEnd);
+        GetTimeofDay(&end);
+        report("deep", n, start, end, cpuEnd - cpuStart);
+
+        GetTimeofDay(&start);
+        CPUTime(&cpuStart);
+        Spawn("Fan", Fan, buf, USLOSS_MIN_STACK, 3, &pid);
+        Wait(&pid, &status);
+        CPUTime(&cpuEnd);
+        GetTimeofDay(&end);
+        report("wide", n, start, end, cpuEnd - cpuStart);
+
+        SemCreate(0, &blockSem);
+        Spawn("Killer", Killer, buf, USLOSS_MIN_STACK, 3, &pid);
+        Wait(&pid, &status);
+        GetTimeofDay(&end);
+        SemFree(blockSem);
+        report("killkids", n, killStart, end, 0);
+    }
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+
+    return 0;
+} /* start3 */
+
+int Null(char *arg)
+{
+    return 0;
+} /* Null */
+
+/*
+ * Link of a chain of the given length
+ */
+int Chain(char *arg)
+{
+    int n = atoi(arg);
+    int pid;
+    int status;
+    char buf[20];
+
+    if (n > 1) {
+        sprintf(buf, "%d", n - 1);
+        Spawn("Chain", Chain, buf, USLOSS_MIN_STACK, 3, &pid);
+        Wait(&pid, &status);
+    }
+    Terminate(0);
+
+    return 0;
+} /* Chain */
+
+/*
+ * Spawns the given number of Null children, then waits for them all
+ */
+int Fan(char *arg)
+{
+    int n = atoi(arg);
+    int pid;
+    int status;
+    int i;
+
+    for (i = 0; i < n; i++)
+        Spawn("Null", Null, NULL, USLOSS_MIN_STACK, 4, &pid);
+    for (i = 0; i < n; i++)
+        Wait(&pid, &status);
+    Terminate(0);
+
+    return 0;
+} /* Fan */
+
+int Blocker(char *arg)
+{
+    SemP(blockSem);
+    Terminate(0);
+
+    return 0;
+} /* Blocker */
+
+/*
+ * Spawns the given number of Blockers, which run at a higher priority
+ * and block at once, then terminates with all of them still blocked
+ */
+int Killer(char *arg)
+{
+    int n = atoi(arg);
+    int pid;
+    int i;
+
+    for (i = 0; i < n; i++)
+        Spawn("Blocker", Blocker, NULL, USLOSS_MIN_STACK, 2, &pid);
+    GetTimeofDay(&killStart);
+    Terminate(0);
+
+    return 0;
+} /* Killer */
@@ -0,0 +1,70 @@
+/*
+ * Tracepoint overhead benchmark. Times the kernel hot paths that carry
+ * tracepoints: SemV/SemP on an uncontended semaphore, and Spawn/Wait of
+ * a child that returns at once. Build it against both libraries
+ * ("make tracepoints tracepoints-debug") and compare the two runs.
+ *
+ * Output lines are machine-readable:
+ *   BENCH tracepoints op=<op> iters=<n> total_us=<t> per_op_ns=<1000*t/n>
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+#include <stdio.h>
+
+#define SEMITERS   10000
+#define SPAWNITERS 200
+
+int Child(char *);
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+int start3(char *arg)
+{
+    int sem;
+    int pid;
+    int status;
+    int i;
+    int start, end;
+
+    USLOSS_Console("start3(): started\n");
+
+    SemCreate(0, &sem);
+    GetTimeofDay(&start);
+    for (i = 0; i < SEMITERS; i++) {
+        SemV(sem);
+        SemP(sem);
+    }
+    GetTimeofDay(&end);
+    SemFree(sem);
+    USLOSS_Console("BENCH tracepoints op=semv_semp iters=%d total_us=%d per_op_ns=%d\n",
+                   SEMITERS, end - start, (int) (1000LL * (end - start) / SEMITERS));
+
+    GetTimeofDay(&start);
+    for (i = 0; i < SPAWNITERS; i++) {
+        Spawn("Child", Child, NULL, USLOSS_MIN_STACK, 4, &pid);
+        Wait(&pid, &status);
+    }
+    GetTimeofDay(&end);
+    USLOSS_Console("BENCH tracepoints op=spawn_wait iters=%d total_us=%d per_op_ns=%d\n",
+                   SPAWNITERS, end - start, (int) (1000LL * (end - start) / SPAWNITERS));
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(0);
+
+    return 0;
+} /* start3 */
+
+int Child(char *arg)
+{
+    return 0;
+} /* Child */
@@ -10,10 +10,9 @@
 #include <phase1.h>
 #include <phase2.h>
 #include <stdint.h>
+#include <phase3.h>
 #include "libuser.h"
 
-extern int debugflag3;
-
 
 #define CHECKMODE {    \
     if (USLOSS_PsrGet() & USLOSS_PSR_CURRENT_MODE) { \
@@ -262,4 +261,777 @@ void GetPID(int *pid)
     *pid = (uintptr_t) sysArg.arg1;
 } /* end of GetPID */
 
+
+/*
+ *  Routine:  PoolCreate
+ *
+ *  Description: Create a pool of worker processes that are reused
+ *               across jobs instead of being spawned for each one.
+ *
+ *  Arguments:    int nworkers  -- number of workers in the pool
+ *                int stacksize -- stack size of each worker
+ *                int priority  -- priority of each worker
+ *                int *pool     -- pointer to output value
+ *                (output value: id of the new pool)
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int PoolCreate(int nworkers, long stack_size, long priority, int *pool)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_POOLCREATE;
+    sysArg.arg1 = (void *) (long) nworkers;
+    sysArg.arg3 = (void *) stack_size;
+    sysArg.arg4 = (void *) priority;
+
+    USLOSS_Syscall(&sysArg);
+
+    *pool = (uintptr_t) sysArg.arg1;
+    return (uintptr_t) sysArg.arg4;
+} /* end of PoolCreate */
+
+
+/*
+ *  Routine:  PoolSubmit
+ *
+ *  Description: Queue a function to be run by one of a pool's workers.
+ *
+ *  Arguments:    int pool      -- id of the pool
+ *                PFV func      -- pointer to the function to run
+ *                void *arg     -- argument to function
+ *                int *ticket   -- pointer to output value
+ *                (output value: ticket to pass to PoolWait)
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int PoolSubmit(int pool, int (*func)(char *), char *arg, int *ticket)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_POOLSUBMIT;
+    sysArg.arg1 = (void *) (long) pool;
+    sysArg.arg2 = (void *) func;
+    sysArg.arg3 = arg;
+
+    USLOSS_Syscall(&sysArg);
+
+    *ticket = (uintptr_t) sysArg.arg1;
+    return (uintptr_t) sysArg.arg4;
+} /* end of PoolSubmit */
+
+
+/*
+ *  Routine:  PoolWait
+ *
+ *  Description: Wait for a submitted job to finish.
+ *
+ *  Arguments:    int ticket    -- ticket returned by PoolSubmit
+ *                int *result   -- pointer to output value
+ *                (output value: value returned by the job's function)
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int PoolWait(int ticket, int *result)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_POOLWAIT;
+    sysArg.arg1 = (void *) (long) ticket;
+
+    USLOSS_Syscall(&sysArg);
+
+    *result = (uintptr_t) sysArg.arg2;
+    return (uintptr_t) sysArg.arg4;
+} /* end of PoolWait */
+
+
+/*
+ *  Routine:  SetPgid
+ *
+ *  Description: Move a process into a process group.
+ *
+ *  Arguments:    int pid       -- process to move, 0 for the caller
+ *                int pgid      -- group to join, 0 for a new group
+ *                                 named after the process
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int SetPgid(int pid, int pgid)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_SETPGID;
+    sysArg.arg1 = (void *) (long) pid;
+    sysArg.arg2 = (void *) (long) pgid;
+
+    USLOSS_Syscall(&sysArg);
+
+    return (uintptr_t) sysArg.arg4;
+} /* end of SetPgid */
+
+
+/*
+ *  Routine:  KillGroup
+ *
+ *  Description: Terminate every process in a process group.
+ *
+ *  Arguments:    int pgid      -- group to terminate
+ *                int status    -- completion status of the members
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int KillGroup(int pgid, long status)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_KILLGROUP;
+    sysArg.arg1 = (void *) (long) pgid;
+    sysArg.arg2 = (void *) status;
+
+    USLOSS_Syscall(&sysArg);
+
+    return (uintptr_t) sysArg.arg4;
+} /* end of KillGroup */
+
+
+/*
+ *  Routine:  WaitGroup
+ *
+ *  Description: Wait for every process in a process group to terminate.
+ *
+ *  Arguments:    int pgid      -- group to wait on
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int WaitGroup(int pgid)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_WAITGROUP;
+    sysArg.arg1 = (void *) (long) pgid;
+
+    USLOSS_Syscall(&sysArg);
+
+    return (uintptr_t) sysArg.arg4;
+} /* end of WaitGroup */
+
+
+/*
+ *  Routine:  SpawnDetached
+ *
+ *  Description: Fork a new user process that is not tied to the caller.
+ *               It is reaped by the kernel when it terminates, so it is
+ *               never returned by Wait and it outlives the caller.
+ *
+ *  Arguments:    same as Spawn
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int SpawnDetached(char *name, int (*func)(char *), char *arg, long stack_size,
+    long priority, int *pid)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_SPAWNDETACHED;
+    sysArg.arg1 = (void *) func;
+    sysArg.arg2 = arg;
+    sysArg.arg3 = (void *) stack_size;
+    sysArg.arg4 = (void *) priority;
+    sysArg.arg5 = name;
+
+    USLOSS_Syscall(&sysArg);
+
+    *pid = (uintptr_t) sysArg.arg1;
+    return (uintptr_t) sysArg.arg4;
+} /* end of SpawnDetached */
+
+
+/*
+ *  Routine:  WaitEx
+ *
+ *  Description: Wait for a child completion, also returning the
+ *               resources the child and its descendants used
+ *
+ *  Arguments:    int *pid -- pointer to output value 1
+ *                (output value 1: process id of the completing child)
+ *                int *status -- pointer to output value 2
+ *                (output value 2: status of the completing child)
+ *                procUsage *usage -- pointer to output value 3
+ *                (output value 3: resource usage of the completing child)
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int WaitEx(int *pid, int *status, procUsage *usage)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_WAITEX;
+    sysArg.arg3 = usage;
+
+    USLOSS_Syscall(&sysArg);
+
+    *pid = (uintptr_t) sysArg.arg1;
+    *status = (uintptr_t) sysArg.arg2;
+    return (uintptr_t) sysArg.arg4;
+} /* end of WaitEx */
+
+
+/*
+ *  Routine:  SpawnArgs
+ *
+ *  Description: Fork a new user process, passing it a buffer by
+ *               reference instead of copying a string argument.
+ *               The buffer must come from malloc and belongs to the
+ *               kernel after a successful call; it is freed once every
+ *               process it was passed to has terminated.
+ *
+ *  Arguments:    char *name    -- new process's name
+ *                PFV func      -- pointer to the function to fork
+ *                void *buf     -- buffer passed to function
+ *                size_t len    -- size of buf
+ *                int stacksize -- amount of stack to be allocated
+ *                int priority  -- priority of forked process
+ *                int  *pid     -- pointer to output value
+ *                (output value: process id of the forked process)
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int SpawnArgs(char *name, int (*func)(char *), void *buf, size_t len,
+    long stack_size, long priority, int *pid)
+{
+    USLOSS_Sysargs sysArg;
+    spawnRequest req;
+
+    CHECKMODE;
+    req.name = name;
+    req.func = func;
+    req.arg = buf;
+    req.len = len;
+    req.stack_size = stack_size;
+    req.priority = priority;
+    req.notifySem = -1;
+    sysArg.number = SYS_SPAWNARGS;
+    sysArg.arg1 = &req;
+
+    USLOSS_Syscall(&sysArg);
+
+    *pid = (uintptr_t) sysArg.arg1;
+    return (uintptr_t) sysArg.arg4;
+} /* end of SpawnArgs */
+
+
+/*
+ *  Routine:  SpawnNotify
+ *
+ *  Description: Fork a new user process that does a "V" on the given
+ *               semaphore when it terminates, so the caller can keep
+ *               working and learn of completions by "P"ing it.
+ *
+ *  Arguments:    same as Spawn, plus
+ *                int semaphore -- semaphore to "V" when the child ends
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int SpawnNotify(char *name, int (*func)(char *), char *arg, long stack_size,
+    long priority, long semaphore, int *pid)
+{
+    USLOSS_Sysargs sysArg;
+    spawnRequest req;
+
+    CHECKMODE;
+    req.name = name;
+    req.func = func;
+    req.arg = arg;
+    req.len = 0;
+    req.stack_size = stack_size;
+    req.priority = priority;
+    req.notifySem = semaphore;
+    sysArg.number = SYS_SPAWNNOTIFY;
+    sysArg.arg1 = &req;
+
+    USLOSS_Syscall(&sysArg);
+
+    *pid = (uintptr_t) sysArg.arg1;
+    return (uintptr_t) sysArg.arg4;
+} /* end of SpawnNotify */
+
+
+/*
+ *  Routine:  SyscallBatch
+ *
+ *  Description: Make several syscalls with a single trap. Each entry
+ *               is filled in as though it had been made on its own.
+ *               The batch stops before the first entry that would
+ *               block, which the caller can then make normally.
+ *               Spawn, SemCreate, SemP, SemV, SemFree, GetPID,
+ *               GetTimeofDay and CPUTime may be batched.
+ *
+ *  Arguments:    USLOSS_Sysargs *vec -- syscalls to make, in order
+ *                int n               -- number of entries in vec
+ *
+ *  Return Value: number of entries completed, -1 means error occurs
+ *
+ */
+int SyscallBatch(USLOSS_Sysargs *vec, int n)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_SYSCALLBATCH;
+    sysArg.arg1 = vec;
+    sysArg.arg2 = (void *) (long) n;
+
+    USLOSS_Syscall(&sysArg);
+
+    if ((long) sysArg.arg4 < 0) {
+        return -1;
+    }
+    return (uintptr_t) sysArg.arg1;
+} /* end of SyscallBatch */
+
+
+/*
+ *  Routine:  RingSetup
+ *
+ *  Description: Register a pair of submission/completion rings for
+ *               making syscalls asynchronously.
+ *
+ *  Arguments:    asyncRing *ring -- the rings, which must stay valid
+ *                                   until the caller terminates
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int RingSetup(asyncRing *ring)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_RINGSETUP;
+    sysArg.arg1 = ring;
+
+    USLOSS_Syscall(&sysArg);
+
+    return (uintptr_t) sysArg.arg4;
+} /* end of RingSetup */
+
+
+/*
+ *  Routine:  RingEnter
+ *
+ *  Description: Submit entries from the caller's submission ring and
+ *               optionally wait for completions.
+ *
+ *  Arguments:    int toSubmit    -- most entries to submit
+ *                int minComplete -- block until this many completions
+ *                                   are waiting to be consumed
+ *
+ *  Return Value: number of entries submitted, -1 means error occurs
+ *
+ */
+int RingEnter(int toSubmit, int minComplete)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_RINGENTER;
+    sysArg.arg1 = (void *) (long) toSubmit;
+    sysArg.arg2 = (void *) (long) minComplete;
+
+    USLOSS_Syscall(&sysArg);
+
+    if ((long) sysArg.arg4 < 0) {
+        return -1;
+    }
+    return (uintptr_t) sysArg.arg1;
+} /* end of RingEnter */
+
+
+/*
+ *  Routine:  GetTimeofDayCoarse
+ *
+ *  Description: Like GetTimeofDay, but read from the kernel's shared
+ *               page without a trap. May lag by up to one clock tick.
+ *
+ *  Arguments:    int *tod -- pointer to output value
+ *
+ */
+void GetTimeofDayCoarse(int *tod)
+{
+    CHECKMODE;
+    *tod = vdso->tod;
+} /* end of GetTimeofDayCoarse */
+
+
+/*
+ *  Routine:  CPUTimeCoarse
+ *
+ *  Description: Like CPUTime, but read from the kernel's shared page
+ *               without a trap. May lag by up to one clock tick.
+ *
+ *  Arguments:    int *cpu -- pointer to output value
+ *
+ */
+void CPUTimeCoarse(int *cpu)
+{
+    CHECKMODE;
+    *cpu = vdso->cpu;
+} /* end of CPUTimeCoarse */
+
+
+/*
+ *  Routine:  GetArgLen
+ *
+ *  Description: Get the size of the buffer the calling process was
+ *               passed by SpawnArgs, read from the kernel's shared page.
+ *
+ *  Arguments:    long *len -- pointer to output value
+ *                (output value: size of the buffer, -1 if the process
+ *                was not started by SpawnArgs)
+ *
+ */
+void GetArgLen(long *len)
+{
+    CHECKMODE;
+    *len = vdso->argLen;
+} /* end of GetArgLen */
+
+
+/*
+ *  Routine:  GetStats
+ *
+ *  Description: Copy one kind of kernel statistics to the caller.
+ *
+ *  Arguments:    int kind   -- one of the STATS_ constants in phase3.h
+ *                void *buf  -- where to copy them
+ *                size_t len -- size of buf in bytes
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int GetStats(int kind, void *buf, size_t len)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_GETSTATS;
+    sysArg.arg1 = (void *) (long) kind;
+    sysArg.arg2 = buf;
+    sysArg.arg3 = (void *) len;
+
+    USLOSS_Syscall(&sysArg);
+
+    return (uintptr_t) sysArg.arg4;
+} /* end of GetStats */
+
+
+/*
+ *  Routine:  GetSyscallStats
+ *
+ *  Description: Fetch the call and error counts and latency histogram
+ *               of every syscall.
+ *
+ *  Arguments:    syscallStats *stats -- array of MAXSYSCALLS entries,
+ *                                       indexed by syscall number
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int GetSyscallStats(syscallStats *stats)
+{
+    return GetStats(STATS_SYSCALLS, stats, MAXSYSCALLS * sizeof(syscallStats));
+} /* end of GetSyscallStats */
+
+
+/*
+ *  Routine:  TraceDrain
+ *
+ *  Description: Move the oldest events out of the kernel trace ring.
+ *
+ *  Arguments:    traceEvent *buf -- where to copy the events
+ *                int max         -- number of entries in buf
+ *                int *lost       -- pointer to output value
+ *                (output value: events overwritten before they could
+ *                 be drained, since the last drain)
+ *
+ *  Return Value: number of events copied, -1 means error occurs
+ *
+ */
+int TraceDrain(traceEvent *buf, int max, int *lost)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_TRACEDRAIN;
+    sysArg.arg1 = buf;
+    sysArg.arg2 = (void *) (long) max;
+
+    USLOSS_Syscall(&sysArg);
+
+    if ((long) sysArg.arg4 < 0) {
+        return -1;
+    }
+    *lost = (uintptr_t) sysArg.arg2;
+    return (uintptr_t) sysArg.arg1;
+} /* end of TraceDrain */
+
+
+/*
+ *  Routine:  GetSwitchStats
+ *
+ *  Description: Fetch how each live process has been switched in and
+ *               out of the CPU.
+ *
+ *  Arguments:    switchStats *stats -- array to fill, one entry per
+ *                                      process; an entry with pid -1
+ *                                      follows the last if there is room
+ *                int max            -- number of entries in stats
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int GetSwitchStats(switchStats *stats, int max)
+{
+    return GetStats(STATS_SWITCHES, stats, max * sizeof(switchStats));
+} /* end of GetSwitchStats */
+
+
+/*
+ *  Routine:  ProfStart
+ *
+ *  Description: Start the sampling profiler, discarding earlier samples.
+ *
+ *  Arguments:
+ *
+ *  Return Value: 0 means success, -1 means it was already running
+ *
+ */
+int ProfStart(void)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_PROFCONTROL;
+    sysArg.arg1 = (void *) 1;
+
+    USLOSS_Syscall(&sysArg);
+
+    return (uintptr_t) sysArg.arg4;
+} /* end of ProfStart */
+
+
+/*
+ *  Routine:  ProfStop
+ *
+ *  Description: Stop the sampling profiler, keeping its samples.
+ *
+ *  Arguments:
+ *
+ *  Return Value: 0 means success, -1 means it was not running
+ *
+ */
+int ProfStop(void)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_PROFCONTROL;
+    sysArg.arg1 = (void *) 0;
+
+    USLOSS_Syscall(&sysArg);
+
+    return (uintptr_t) sysArg.arg4;
+} /* end of ProfStop */
+
+
+/*
+ *  Routine:  ProfDump
+ *
+ *  Description: Fetch the samples the profiler has taken, one entry
+ *               for each pid sampled.
+ *
+ *  Arguments:    profEntry *buf -- where to copy the entries
+ *                int max        -- number of entries in buf
+ *                int *dropped   -- pointer to output value
+ *                (output value: samples dropped because too many
+ *                 pids were sampled)
+ *
+ *  Return Value: number of entries copied, -1 means error occurs
+ *
+ */
+int ProfDump(profEntry *buf, int max, int *dropped)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_PROFDUMP;
+    sysArg.arg1 = buf;
+    sysArg.arg2 = (void *) (long) max;
+
+    USLOSS_Syscall(&sysArg);
+
+    if ((long) sysArg.arg4 < 0) {
+        return -1;
+    }
+    *dropped = (uintptr_t) sysArg.arg2;
+    return (uintptr_t) sysArg.arg1;
+} /* end of ProfDump */
+
+
+/*
+ *  Routine:  GetWakeupStats
+ *
+ *  Description: Fetch the latency from SemV waking a process blocked
+ *               in SemP to that SemP returning, across all semaphores.
+ *
+ *  Arguments:    wakeupStats *stats -- pointer to output value
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int GetWakeupStats(wakeupStats *stats)
+{
+    return GetStats(STATS_WAKEUPS, stats, sizeof(wakeupStats));
+} /* end of GetWakeupStats */
+
+
+/*
+ *  Routine:  GetSemWakeupStats
+ *
+ *  Description: Fetch the wakeup latency of each live semaphore.
+ *
+ *  Arguments:    wakeupStats *stats -- array to fill, one entry per
+ *                                      semaphore; an entry with handle
+ *                                      -1 follows the last if there is room
+ *                int max            -- number of entries in stats
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int GetSemWakeupStats(wakeupStats *stats, int max)
+{
+    return GetStats(STATS_SEMWAKEUPS, stats, max * sizeof(wakeupStats));
+} /* end of GetSemWakeupStats */
+
+
+/*
+ *  Routine:  GetStackStats
+ *
+ *  Description: Fetch how much of its stack each live process has used.
+ *
+ *  Arguments:    stackStats *stats -- array to fill, one entry per
+ *                                     process; an entry with pid -1
+ *                                     follows the last if there is room
+ *                int max           -- number of entries in stats
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int GetStackStats(stackStats *stats, int max)
+{
+    return GetStats(STATS_STACKS, stats, max * sizeof(stackStats));
+} /* end of GetStackStats */
+
+
+/*
+ *  Routine:  GetSystemSnapshot
+ *
+ *  Description: Take a consistent snapshot of every live process and
+ *               semaphore, laid out as described in phase3.h.
+ *
+ *  Arguments:    void *buf  -- where to write the snapshot
+ *                size_t len -- size of buf in bytes
+ *                int *size  -- pointer to output value
+ *                (output value: bytes written, or if buf was too small,
+ *                 bytes it needed to be)
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int GetSystemSnapshot(void *buf, size_t len, int *size)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_SNAPSHOT;
+    sysArg.arg1 = buf;
+    sysArg.arg2 = (void *) len;
+
+    USLOSS_Syscall(&sysArg);
+
+    *size = (uintptr_t) sysArg.arg1;
+    return (uintptr_t) sysArg.arg4;
+} /* end of GetSystemSnapshot */
+
+
+/*
+ *  Routine:  Sleep
+ *
+ *  Description: Suspend the calling process for at least the given
+ *               number of seconds.
+ *
+ *  Arguments:    int seconds -- how long to sleep
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int Sleep(int seconds)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_SLEEP;
+    sysArg.arg1 = (void *) (long) seconds;
+    sysArg.arg2 = (void *) 0;
+
+    USLOSS_Syscall(&sysArg);
+
+    return (uintptr_t) sysArg.arg4;
+} /* end of Sleep */
+
+
+/*
+ *  Routine:  SleepUs
+ *
+ *  Description: Suspend the calling process for at least the given
+ *               number of microseconds, rounded up to whole clock ticks.
+ *
+ *  Arguments:    long us -- how long to sleep
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int SleepUs(long us)
+{
+    USLOSS_Sysargs sysArg;
+
+    CHECKMODE;
+    sysArg.number = SYS_SLEEP;
+    sysArg.arg1 = (void *) 0;
+    sysArg.arg2 = (void *) us;
+
+    USLOSS_Syscall(&sysArg);
+
+    return (uintptr_t) sysArg.arg4;
+} /* end of SleepUs */
+
 /* end libuser.c */
@@ -5,6 +5,10 @@
 #ifndef _LIBUSER_H
 #define _LIBUSER_H
 
+#include <stddef.h>
+#include <usloss.h>
+#include <phase3.h>
+
 // Phase 3 -- User Function Prototypes
 extern int  Spawn(char *name, int (*func)(char *), char *arg, long stack_size,
                   long priority, int *pid);
@@ -13,9 +17,41 @@ extern void Terminate(long status);
 extern void GetTimeofDay(int *tod);
 extern void CPUTime(int *cpu);
 extern void GetPID(int *pid);
+extern void GetTimeofDayCoarse(int *tod);
+extern void CPUTimeCoarse(int *cpu);
+extern void GetArgLen(long *len);
 extern int  SemCreate(long value, int *semaphore);
 extern int  SemP(long semaphore);
 extern int  SemV(long semaphore);
 extern int  SemFree(long semaphore);
+extern int  PoolCreate(int nworkers, long stack_size, long priority, int *pool);
+extern int  PoolSubmit(int pool, int (*func)(char *), char *arg, int *ticket);
+extern int  PoolWait(int ticket, int *result);
+extern int  SetPgid(int pid, int pgid);
+extern int  KillGroup(int pgid, long status);
+extern int  WaitGroup(int pgid);
+extern int  SpawnDetached(char *name, int (*func)(char *), char *arg,
+                          long stack_size, long priority, int *pid);
+extern int  WaitEx(int *pid, int *status, procUsage *usage);
+extern int  SpawnArgs(char *name, int (*func)(char *), void *buf, size_t len,
+                      long stack_size, long priority, int *pid);
+extern int  SpawnNotify(char *name, int (*func)(char *), char *arg,
+                        long stack_size, long priority, long semaphore, int *pid);
+extern int  SyscallBatch(USLOSS_Sysargs *vec, int n);
+extern int  RingSetup(asyncRing *ring);
+extern int  RingEnter(int toSubmit, int minComplete);
+extern int  GetStats(int kind, void *buf, size_t len);
+extern int  GetSyscallStats(syscallStats *stats);
+extern int  GetSwitchStats(switchStats *stats, int max);
+extern int  GetWakeupStats(wakeupStats *stats);
+extern int  GetSemWakeupStats(wakeupStats *stats, int max);
+extern int  GetStackStats(stackStats *stats, int max);
+extern int  GetSystemSnapshot(void *buf, size_t len, int *size);
+extern int  Sleep(int seconds);
+extern int  SleepUs(long us);
+extern int  TraceDrain(traceEvent *buf, int max, int *lost);
+extern int  ProfStart(void);
+extern int  ProfStop(void);
+extern int  ProfDump(profEntry *buf, int max, int *dropped);
 
 #endif
@@ -1,5 +1,7 @@
 
 #include <usloss.h>
+#include <phase1.h>
+#include <phase3.h>
 #define DEBUG 1
 extern int debugflag;
 
@@ -8,6 +10,7 @@ p1_fork(int pid)
 {
     if (DEBUG && debugflag)
         USLOSS_Console("p1_fork() called: pid = %d\n", pid);
+    p3_fork(pid);
 } /* p1_fork */
 
 void
@@ -15,6 +18,7 @@ p1_switch(int old, int new)
 {
     if (DEBUG && debugflag)
         USLOSS_Console("p1_switch() called: old = %d, new = %d\n", old, new);
+    p3_switch(old, new);
 } /* p1_switch */
 
 void
@@ -22,6 +26,7 @@ p1_quit(int pid)
 {
     if (DEBUG && debugflag)
         USLOSS_Console("p1_quit() called: pid = %d\n", pid);
+    p3_quit(pid);
 } /* p1_quit */
 
 // int
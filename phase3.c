@@ -12,16 +12,54 @@
 
 /* FUNCTION PROTOTYPES */
 int spawnReal();
+int forkProc();
+void spawnargs();
+argBufPtr holdArgBuf(void * data, long len);
+void dropArgBuf(argBufPtr buf, int freeData);
+void releaseArgBuf(p3ProcPtr proc);
+int reapDetached(int * status);
+void spawndetached();
 int waitReal();
 void terminateReal();
 int start3();
-int spawnLaunch();
+int spawnLaunch(char * arg);
 void initProcTable();
+int allocProcSlab();
+void freeProcSlab(p3ProcPtr slab, int count);
+p3ProcPtr newProc();
+void freeProc(p3ProcPtr proc);
+p3ProcPtr procAt(int index);
 void initSemTable();
 void initSyscallVec();
+void syscallDispatch();
+void syscallDone(p3ProcPtr me);
+int statBucket(int value);
+void getstats();
+int copySwitchStats(switchStats * buf, long len);
+int copySemWakeups(wakeupStats * buf, long len);
+void wakeupDone(p3ProcPtr me, int handle);
+void paintStack(p3ProcPtr me);
+int stackHighWater(p3ProcPtr proc);
+int copyStackStats(stackStats * buf, long len);
+void snapshot();
+void traceRecord(int type, int pid, int arg1, int arg2);
+void tracedrain();
+void profcontrol();
+void profdump();
+void profClockHandler(int dev, void *arg);
+void initTimeline();
+void writeTimeline();
+void writePerf();
+void waitex();
+int waitRealEx(int * status, procUsage * usage);
+int waitableKids(p3ProcPtr proc);
+int readClock();
+void initVdso();
+void vdsoClockHandler(int dev, void *arg);
 void initProc();
 void nullsys3();
 void spawn();
+int validPriority(long priority);
 void wait();
 void terminate();
 void gettimeofday();
@@ -30,18 +68,63 @@ void cputime();
 void semcreate();
 long semcreateReal(int val);
 void semp();
+int sempReal(int handle, int block);
 void semv();
+int semvReal(int handle);
+void spawnnotify();
 void semfree();
+int semfreeReal(int handle);
+void syscallbatch();
+int batchOne(USLOSS_Sysargs *args);
+void initRingTable();
+void sleep3();
+int sleepReal(long us);
+int startClockDaemon();
+int forkClockDaemon();
+int clockDaemon(char * arg);
+void wheelAdd(p3ProcPtr proc);
+void wheelRemove(p3ProcPtr proc);
+void wheelCascade(int level, int slot);
+void wheelAdvance(int target);
+void ringsetup();
+void ringenter();
+int ringWorker(char * arg);
+void ringPost(ringPtr rng, ringSqe * sqe);
+void ringDefer(ringPtr rng, ringSqe * sqe);
+int ringDeferred(ringPtr rng, int handle);
+void ringUndefer(ringPtr rng, int handle);
+void ringReapWaits(ringPtr rng, p3ProcPtr me);
+void destroyRing(p3ProcPtr proc);
 void check_kernel_mode(char * arg);
 int isInKernelMode();
 int enterUserMode();
 p3ProcPtr getCurrentProc();
 p3ProcPtr getProc();
+p3ProcPtr lookupProc(int pid);
+semPtr lookupSem(int handle);
 void zapChildren();
+void markSubtreeDying();
+void markDying();
+int isDying();
 int getNextSemID();
 void cleanupProc();
 void dumpProcesses3();
 int Terminate();
+void initPoolTable();
+void poolcreate();
+void poolsubmit();
+void poolwait();
+void poolnext();
+int poolWorker(char * arg);
+void finishPoolJob(p3ProcPtr proc, int result);
+void destroyPools(int ownerPid);
+void initGroupTable();
+void setpgid();
+void killgroup();
+void waitgroup();
+groupPtr getGroup(int pgid, int create);
+void joinGroup(p3ProcPtr proc, int pgid);
+void leaveGroup(p3ProcPtr proc);
 
 typedef struct launchArgs * launchArgsPtr;
 typedef struct launchArgs launchArgs;
@@ -55,13 +138,52 @@ struct launchArgs {
 
 /* GLOBAL DATA STRUCTURES */
 
-p3Proc ProcTable[MAXPROC];  //phase 3 proctable
+p3ProcPtr * ProcSlabs = NULL; //phase 3 proctable, grown PROCSLAB entries at a time
+int numProcSlabs = 0;       //number of slabs allocated
+p3ProcPtr freeProcs = NULL; //PTEs not in use by any proc
+p3ProcPtr ProcHash[PROCHASHSIZE]; //live PTEs, chained by pid
 sem SemTable[MAXSEMS];      //semaphore table
 int nextSemId = 0;          //next valid, unused semaphore ID
 int numSems = 0;            //number of active semaphores
 int semTableMbox;           //mutex mailbox for the semaphore table
-
-int debugflag3 = 0;
+pool PoolTable[MAXPOOLS];   //worker-process pools
+poolJob PoolJobTable[MAXPOOLJOBS]; //jobs submitted to any pool
+int poolTableMbox;          //mutex mailbox for the pool and job tables
+group GroupTable[MAXGROUPS]; //process groups, kept next to ProcTable
+int groupTableMbox;         //mutex mailbox for the group table
+int start3Pid;              //parent of all detached procs
+int reaperMboxId;           //spawn requests and exit notices for detached procs, received by start2
+argBufPtr argBufs = NULL;   //buffers handed to procs by SpawnArgs
+int argBufMbox;             //mutex mailbox for argBufs
+ring RingTable[MAXRINGS];   //async syscall rings
+int ringTableMbox;          //mutex mailbox for the ring table and the rings' queues
+syscallStats SyscallStats[MAXSYSCALLS]; //per syscall number
+int syscallReportsStatus[MAXSYSCALLS]; //1 if the syscall's handler sets arg4 to -1 on failure
+traceEvent TraceRing[TRACESIZE]; //kernel event trace, see traceRecord
+unsigned int traceHead;     //oldest event not yet drained
+unsigned int traceTail;     //where the next event goes
+int traceLost;              //events overwritten before they were drained
+traceEvent * Timeline;      //every event since start2 for the Chrome trace, NULL if not wanted
+int timelineLen;
+vdsoPage vdsoData;          //written here, read by libuser through vdso
+const volatile vdsoPage * const vdso = &vdsoData;
+void (*prevClockHandler)(int dev, void *arg); //handler installed before ours
+profEntry ProfTable[PROFSLOTS]; //samples per pid, hashed by pid, empty slots have pid -1
+int profDropped;            //samples for pids that found no free slot
+int profiling;              //1 while profClockHandler is installed
+void (*profPrevHandler)(int dev, void *arg); //handler profClockHandler passes ticks on to
+int WakeupStats[WAKEPRIOS][STATBUCKETS]; //wakeup latency across all semaphores, by priority
+int perfCpu;                //us phase3 procs have held the CPU, for the PERF line
+int perfSyscalls;           //syscalls dispatched, for the PERF line
+int lastSwitchAt;           //time of day of the last switch
+int runningIsP3;            //1 if the proc switched in last is a phase3 proc
+p3ProcPtr TimerWheel[WHEELLEVELS][WHEELSIZE]; //sleepers, by the tick they wake at
+int wheelTick = -1;         //last tick the clock daemon processed, -1 before the first Sleep
+int wheelMbox;              //mutex mailbox for the timer wheel
+int clockDaemonPid = -1;    //pid of the clock daemon, -1 until the first Sleep starts it
+int inClockTick;            //set by the clock handler, the next switch is a time slice and clears it
+
+void (*syscallTable[MAXSYSCALLS])(USLOSS_Sysargs *); //phase3 function for each syscall
 
 int start2(char *arg)
 {
@@ -71,9 +193,7 @@ int start2(char *arg)
      * Check kernel mode here.
      */
     check_kernel_mode("start2");
-    if (debugflag3){
-        USLOSS_Console("start2(): called in kernel mode\n");
-    }
+    TP(TPC_PROC, TP_DEBUG, "start2(): called in kernel mode\n");
 
     /*
      * Data structure initialization as needed...
@@ -85,14 +205,46 @@ int start2(char *arg)
     //intialize sem table, create mailboxes for each semaphore
     initSemTable();
 
+    //initialize pool and job tables, create mailboxes for each job
+    initPoolTable();
+
+    //initialize group table, create wait mailboxes for each group
+    initGroupTable();
+
     //intialize system call vector with phase3 function pointers
     initSyscallVec();
 
     //initialize this proc with parent pid -1
-    initProc(getpid(), -1);
+    initProc(newProc(), getpid(), -1);
+    getCurrentProc()->priority = 1;
 
     //intialize semtable mutex
     semTableMbox = MboxCreate(1,0);
+
+    //initialize pool table mutex
+    poolTableMbox = MboxCreate(1,0);
+
+    //initialize group table mutex
+    groupTableMbox = MboxCreate(1,0);
+
+    //initialize mailbox start2 reaps detached procs through
+    reaperMboxId = MboxCreate(MAXPROC, sizeof(reaperMsg));
+
+    //initialize SpawnArgs buffer list mutex
+    argBufMbox = MboxCreate(1,0);
+
+    //initialize ring table and its mutex
+    initRingTable();
+    ringTableMbox = MboxCreate(1,0);
+
+    //initialize timer wheel mutex, the clock daemon is only started by the first Sleep
+    wheelMbox = MboxCreate(1,0);
+
+    //start keeping the shared page current
+    initVdso();
+
+    //keep a timeline of trace events if one should be written at shutdown
+    initTimeline();
     
 
     /*
@@ -124,102 +276,172 @@ int start2(char *arg)
      * return to the user code that called Spawn.
      */
 
-    //spawn start3
-    pid = spawnReal("start3", start3, NULL, USLOSS_MIN_STACK, 3);
+    //spawn start3, detached so that start2 reaps it along with every other detached proc
+    start3Pid = forkProc("start3", start3, NULL, USLOSS_MIN_STACK, 3, getpid(), FORK_DETACHED, NULL, -1);
 
-    /* Call the waitReal version of your wait code here.
-     * You call waitReal (rather than Wait) because start2 is running
-     * in kernel (not user) mode.
+    /* Instead of calling waitReal for start3, start2 stays in reapDetached()
+     * until start3 and every detached proc has been joined. Detached procs
+     * are forked by start2 so that they can outlive the proc that asked
+     * for them; only start2 can join them.
      */
 
-    //wait for start3 to finish
-    pid = waitReal(&status);
+    //wait for start3 and all detached procs to finish
+    pid = reapDetached(&status);
 
-    if (debugflag3){
-        USLOSS_Console("start2(): done with waitReal pid = %d\n", pid );
+    TP(TPC_PROC, TP_INFO, "start2(): done with waitReal pid = %d\n", pid );
+
+    //stop the clock daemon, if anything slept, so that start2 quits without children
+    if (clockDaemonPid >= 0){
+        zap(clockDaemonPid);
+        join(&status);
     }
 
+    writeTimeline();
+    writePerf();
+
     return 0;
 } /* start2 */
 
+/*
+Loop run by start2 once start3 has been spawned. Forks the detached procs requested
+through SpawnDetached and joins every detached proc as it terminates. Returns the pid of
+start3, with its quit status in *status, once no detached procs remain.
+*/
+int reapDetached(int * status){
+    int numDetached = 1;    //start3
+    int result;
+    reaperMsg msg;
+
+    while (numDetached > 0){
+        MboxReceive(reaperMboxId, &msg, sizeof(reaperMsg));
+
+        if (msg.type == REAP_SPAWN){
+            detachReqPtr req = msg.req;
+            req->pid = forkProc(req->name, req->func, req->arg, req->stack_size, req->priority, start3Pid, FORK_DETACHED, NULL, -1);
+            if (req->pid >= 0){
+                numDetached++;
+            }
+            //wake up the requester blocked in spawndetached()
+            MboxSend(getProc(msg.pid)->privateMboxId, NULL, 0);
+        }
+        else if (msg.type == REAP_DAEMON){
+            clockDaemonPid = forkClockDaemon();
+            //wake up the requester blocked in startClockDaemon()
+            MboxSend(getProc(msg.pid)->privateMboxId, NULL, 0);
+        }
+        else if (msg.type == REAP_EXIT){
+            int pid = join(&result);
+            TP(TPC_PROC, TP_INFO, "reapDetached(): reaped detached pid %d\n", pid);
+            if (pid == start3Pid){
+                *status = result;
+            }
+            numDetached--;
+        }
+    }
+
+    return start3Pid;
+}
+
 
 /*
 Calls fork1 to create new process which starts executing in spawnLaunch(). Initializes
 the PTE for the new proc and then wakes up the child process. Returns the pid of the forked child.
 */
 int spawnReal(char *name, int (*func)(char *), char *arg, long stack_size, long priority){
-    if (debugflag3){
-        USLOSS_Console("spawnReal(): called to spawn %s\n", name);
+    return forkProc(name, func, arg, stack_size, priority, getpid(), 0, NULL, -1);
+}
+
+/*
+Does the work of spawnReal. The new proc is a phase1 child of the caller but is put on
+parentPid's child list. flags may hold FORK_DETACHED, to have start2 reap the proc instead
+of its parent, and FORK_WORKER, to keep Wait from returning it.
+If argBuf is not NULL the child is passed its data instead of a copy of arg, and holds
+one of its references until it terminates. If notifySem is not -1 the child does a V on
+that semaphore when it terminates.
+*/
+int forkProc(char *name, int (*func)(char *), char *arg, long stack_size, long priority, int parentPid, int flags, argBufPtr argBuf, int notifySem){
+    TP(TPC_PROC, TP_DEBUG, "spawnReal(): called to spawn %s\n", name);
+    //get a PTE before forking, the child may run before fork1 returns to us
+    p3ProcPtr kidProc = newProc();
+    if (kidProc == NULL){
+        TP(TPC_PROC, TP_ERROR, "spawnReal(): no memory for another PTE\n");
+        return -1;
     }
-    //call fork1 to spawnLaunch
-    int kidpid = fork1(name, spawnLaunch, NULL, (int)stack_size, (int)priority);
+
+    //call fork1 to spawnLaunch, telling the child where its PTE is
+    char index[MAXARG];
+    snprintf(index, MAXARG, "%d", kidProc->index);
+    int kidpid = fork1(name, spawnLaunch, index, (int)stack_size, (int)priority);
 
     //Error check if fork1 failed
     if (kidpid < 0){
-        if (debugflag3){
-            USLOSS_Console("spawnReal(): fork1 failed pid = %d", kidpid);
-        }
+        TP(TPC_PROC, TP_ERROR, "spawnReal(): fork1 failed pid = %d", kidpid);
+        freeProc(kidProc);
         return -1; 
     }
 
     //intialize the PTE for the new process
-    initProc(kidpid, getpid());
-
-    //get pointer to new proc
-    p3ProcPtr kidProc = getProc(kidpid);
-
-    //save function pointer and arg to PTE
+    initProc(kidProc, kidpid, parentPid);
+    kidProc->priority = priority;
+    kidProc->usage.stackSize = stack_size;
+    kidProc->detached = (flags & FORK_DETACHED) != 0;
+    kidProc->worker = (flags & FORK_WORKER) != 0;
+    kidProc->argBuf = argBuf;
+    kidProc->notifySem = notifySem;
+
+    //save function pointer and arg to PTE, truncating args longer than MAXARG
+    kidProc->arg[0] = '\0';
     if (arg != NULL){
-        memcpy(kidProc->arg, arg, strlen(arg) + 1);
+        strncpy(kidProc->arg, arg, MAXARG);
+        kidProc->arg[MAXARG] = '\0';
     }
 
     //copy func to kid proc
     kidProc->func = func;
 
+    traceRecord(TRACE_SPAWN, kidpid, parentPid, 0);
+
     //wake up child who's blocked in spawnLaunch()
     MboxSend(kidProc->spawnMboxId, NULL, 0);
 
-    if (debugflag3){
-        USLOSS_Console("spawnReal(): pid %d finally finished spawning pid %d\n", getpid(), kidpid );
-    }
+    TP(TPC_PROC, TP_INFO, "spawnReal(): pid %d finally finished spawning pid %d\n", getpid(), kidpid );
 
     //return pid of successful fork
     return kidpid;
 }
 
 /*
-A newly forked child starts executing here. It waits for parent to finish initializing
-the PTE by receiving on it's mbox. It terminates if zapped while waiting. Then it
+A newly forked child starts executing here, with the index of its PTE as its arg. It
+waits for parent to finish initializing the PTE by receiving on it's mbox. It terminates if zapped while waiting. Then it
 enters usermode and calls the actually user mode function. Last it calls terminate to finish
 if the function code didn't call terminate.
 */
-int spawnLaunch(){
-    if (debugflag3){
-        USLOSS_Console("spawnLaunch(): called by pid %d\n", getpid());
-    }
+int spawnLaunch(char * arg){
+    char top;
+    TP(TPC_PROC, TP_DEBUG, "spawnLaunch(): called by pid %d\n", getpid());
 
-    //get current proc ptr
-    p3ProcPtr me = getCurrentProc();
+    //get current proc ptr, it isn't in ProcHash until spawnReal has initialized it
+    p3ProcPtr me = procAt(atoi(arg));
 
     //wait for spawnReal to finish creating pte
     MboxReceive(me->spawnMboxId, NULL, 0);
 
     //terminate if zapped while waiting
-    if (isZapped()){
-        if (debugflag3){
-            USLOSS_Console("spawnLaunch(): pid %d was zapped, calling terminate\n", me->pid);
-        }
+    if (isDying()){
+        TP(TPC_PROC, TP_INFO, "spawnLaunch(): pid %d was zapped, calling terminate\n", me->pid);
         terminateReal(1);
     }
 
+    //mark the unused stack so terminateReal can tell how much of it func used
+    me->stackTop = &top;
+    paintStack(me);
+
     //switch to user mode
     enterUserMode();
 
     //call function
-    me->func(me->arg);
-    if (debugflag3){
-        USLOSS_Console("spawnLaunch(): finished executing func\n");
-    }
+    me->func(me->argBuf != NULL ? me->argBuf->data : me->arg);
+    TP(TPC_PROC, TP_DEBUG, "spawnLaunch(): finished executing func\n");
 
     //user-mode terminate (becuase we switched to user mode)
     Terminate(1); 
@@ -229,27 +451,79 @@ int spawnLaunch(){
 
 /*
 Calls join to wait for a child process to finish. Stores the quit status
-of the child process in *status. Returns the pid of the quit process.
+of the child process in *status. Returns the pid of the quit process, or
+-2 if the caller has no children to wait for.
 */
 int waitReal(int * status){
-    if (debugflag3){
-        USLOSS_Console("waitReal(): called by pid %d\n", getpid());
-    }
+    return waitRealEx(status, NULL);
+}
+
+/*
+Does the work of waitReal. Also folds the child's resource usage, which includes that
+of its own reaped descendants, into the caller's, and copies it to *usage if not NULL.
+Pool and ring workers are joined and their usage folded in like any child's, but they
+are never returned: Wait only sees the children the caller spawned itself.
+*/
+int waitRealEx(int * status, procUsage * usage){
+    TP(TPC_PROC, TP_DEBUG, "waitReal(): called by pid %d\n", getpid());
+    p3ProcPtr me = getCurrentProc();
     //result pointer
     int result;
+    int pid;
+    int worker;
 
-    //call join to wait for a child to finish
-    int pid = join(&result);
+    do {
+        //call join to wait for a child to finish, unless only workers are left to join
+        pid = waitableKids(me) > 0 ? join(&result) : -2;
 
-    //terminate if join fails
-    if (pid < 0){
-        fprintf(stderr, "waitReal(): join result < 0, terminate.\n");
-        terminateReal(1);
-    }
+        //nothing to wait for
+        if (pid == -2){
+            if (usage != NULL){
+                memset(usage, 0, sizeof(procUsage));
+            }
+            return pid;
+        }
 
-    if (debugflag3){
-        USLOSS_Console("waitReal(): pid %d after join of pid %d\n", getpid(), pid);
-    }
+        //terminate if zapped while waiting in join
+        if (pid < 0){
+            fprintf(stderr, "waitReal(): join result < 0, terminate.\n");
+            terminateReal(1);
+        }
+
+        TP(TPC_PROC, TP_INFO, "waitReal(): pid %d after join of pid %d\n", getpid(), pid);
+
+        //find the usage the child left behind when it terminated
+        exitRecordPtr prev = NULL;
+        exitRecordPtr rec = me->exitedKids;
+        while (rec != NULL && rec->pid != pid){
+            prev = rec;
+            rec = rec->next;
+        }
+        worker = 0;
+        if (rec != NULL){
+            if (prev == NULL){
+                me->exitedKids = rec->next;
+            } else {
+                prev->next = rec->next;
+            }
+            me->usage.childCpuTime += rec->usage.cpuTime + rec->usage.childCpuTime;
+            me->usage.childSyscalls += rec->usage.syscalls + rec->usage.childSyscalls;
+            me->usage.childSwitches += rec->usage.switches + rec->usage.childSwitches;
+            if (rec->usage.stackHighWater > me->usage.childStackHighWater){
+                me->usage.childStackHighWater = rec->usage.stackHighWater;
+            }
+            if (rec->usage.childStackHighWater > me->usage.childStackHighWater){
+                me->usage.childStackHighWater = rec->usage.childStackHighWater;
+            }
+            worker = rec->worker;
+            if (usage != NULL && !worker){
+                *usage = rec->usage;
+            }
+            free(rec);
+        } else if (usage != NULL){
+            memset(usage, 0, sizeof(procUsage));
+        }
+    } while (worker);
 
     //put result into status pointer
     *status = result;
@@ -258,26 +532,101 @@ int waitReal(int * status){
     return pid; 
 }
 
+/*
+Returns the number of proc's children, live or quit but not yet joined, that Wait
+can return. Workers are left out, they only quit once their pool or ring is gone.
+*/
+int waitableKids(p3ProcPtr proc){
+    int count = 0;
+    for (p3ProcPtr child = proc->children; child != NULL; child = child->nextChild){
+        if (!child->worker){
+            count++;
+        }
+    }
+    for (exitRecordPtr rec = proc->exitedKids; rec != NULL; rec = rec->next){
+        if (!rec->worker){
+            count++;
+        }
+    }
+    return count;
+}
+
 /*
 Terminates the currently executing process with the given status by zapping
 all of its children, removing it from it's parents child list, and calling quit. 
 */
 void terminateReal(int status){
-    if (debugflag3){
-        USLOSS_Console("terminateReal(): called by pid %d with status = %d\n", getpid(), status);
-    }
+    TP(TPC_PROC, TP_DEBUG, "terminateReal(): called by pid %d with status = %d\n", getpid(), status);
 
     //get current proc pointer
     p3ProcPtr me = getCurrentProc();
 
-    //zap all the children
+    //a proc killed through its group exits with the status given to KillGroup
+    if (me->killed){
+        status = me->killStatus;
+    }
+    traceRecord(TRACE_TERMINATE, me->pid, status, 0);
+
+    //measure our stack before anything below tears down the PTE
+    me->usage.stackHighWater = stackHighWater(me);
+
+    //a pool worker leaving in the middle of a job fails it, so PoolWait doesn't block forever
+    finishPoolJob(me, -1);
+
+    //shut down any pools we own so their workers stop waiting for jobs
+    destroyPools(me->pid);
+
+    //and any ring we own, its workers are among our children
+    destroyRing(me);
+
+    //start the whole subtree terminating at once, then zap all the children
     if (me->numKids > 0){
+        markSubtreeDying(me);
         zapChildren(me);
     }
     
+    //leave our usage for the parent to collect when it joins us, start2 doesn't collect it for detached procs
+    p3ProcPtr parent = lookupProc(me->parentPid);
+    if (!me->detached && parent != NULL){
+        exitRecordPtr rec = malloc(sizeof(exitRecord));
+        if (rec != NULL){
+            me->usage.cpuTime = readtime();
+            me->usage.exitTime = readClock();
+            rec->pid = me->pid;
+            rec->worker = me->worker;
+            rec->usage = me->usage;
+            rec->next = parent->exitedKids;
+            parent->exitedKids = rec;
+        }
+
+        //a parent with async Waits pending on its ring can now complete one
+        if (parent->ringId >= 0 && RingTable[parent->ringId].ownerPid == parent->pid){
+            MboxCondSend(RingTable[parent->ringId].eventMboxId, NULL, 0);
+        }
+    }
+
+    //drop our reference to a SpawnArgs buffer, freeing it if we were the last user
+    releaseArgBuf(me);
+
     //reset fields and remove from parent's list 
+    int detached = me->detached;
+    int notifySem = me->notifySem;
     cleanupProc(me); 
 
+    //tell a SpawnNotify parent we are about to quit, its Wait blocks at most until we do
+    if (notifySem >= 0){
+        semvReal(notifySem);
+    }
+
+    //detached procs are joined by start2, tell it one is about to quit
+    if (detached){
+        reaperMsg msg;
+        msg.type = REAP_EXIT;
+        msg.pid = getpid();
+        msg.req = NULL;
+        MboxSend(reaperMboxId, &msg, sizeof(reaperMsg));
+    }
+
     //call quit to actually terminate the proc
     quit(status);
 }
@@ -292,15 +641,11 @@ void zapChildren(p3ProcPtr proc){
 
     //loop through all children
     while (child != NULL){
-        if (debugflag3){
-            USLOSS_Console("terminateReal(): pid %d waiting to zap pid %d\n", proc->pid, child->pid);
-        }
+        TP(TPC_PROC, TP_INFO, "terminateReal(): waiting to zap pid %d from pid %d\n", child->pid, proc->pid);
         int x = child->pid;
         //call zap and wait for child to quit
         zap(child->pid);
-        if (debugflag3){
-            USLOSS_Console("terminateReal(): pid %d finished zapping pid %d\n", proc->pid, x);
-        }
+        TP(TPC_PROC, TP_INFO, "terminateReal(): finished zapping pid %d from pid %d\n", x, proc->pid);
         //child is no longer on proc's list
         //decrement numkids
         proc->numKids--;
@@ -310,16 +655,101 @@ void zapChildren(p3ProcPtr proc){
     proc->children = NULL;
 }
 
+/*
+Marks every descendant of the given proc as dying and wakes any that are blocked
+on a semaphore, so the whole subtree terminates concurrently. Without this each zap
+in zapChildren only starts the next level once the level above has been reached.
+markDying blocks, and a woken child may quit and its PTE be reused before it returns,
+so the children are taken from a copy of their pids rather than from the list.
+*/
+void markSubtreeDying(p3ProcPtr proc){
+    int pid = proc->pid;
+    int kids[MAXPROC];
+    int numKids = 0;
+    for (p3ProcPtr child = proc->children; child != NULL && numKids < MAXPROC; child = child->nextChild){
+        kids[numKids++] = child->pid;
+    }
+
+    for (int i = 0; i < numKids; i++){
+        p3ProcPtr child = lookupProc(kids[i]);
+        if (child != NULL && child->parentPid == pid){
+            TP(TPC_PROC, TP_INFO, "markSubtreeDying(): pid %d marking pid %d dying\n", pid, kids[i]);
+            markDying(child);
+        }
+    }
+}
+
+/*
+Marks a single proc and its subtree as dying. If the proc is blocked on a
+semaphore it is pulled off the blocked list and woken so it can terminate.
+Once woken it may quit while we block on a mutex, and then its own terminateReal
+has already dealt with its subtree.
+*/
+void markDying(p3ProcPtr proc){
+    if (proc->dying){
+        return;
+    }
+    proc->dying = 1;
+    int pid = proc->pid;
+
+    int semId = proc->blockedSem;
+    if (semId >= 0){
+        MboxSend(SemTable[semId].mbox, NULL, 0);
+        if (lookupProc(pid) == proc && proc->blockedSem == semId){
+            p3ProcPtr curr = SemTable[semId].blockedList;
+            p3ProcPtr prev = NULL;
+            while (curr != NULL && curr != proc){
+                prev = curr;
+                curr = curr->nextBlocked;
+            }
+            if (curr != NULL){
+                if (prev == NULL){
+                    SemTable[semId].blockedList = proc->nextBlocked;
+                } else {
+                    prev->nextBlocked = proc->nextBlocked;
+                }
+                proc->nextBlocked = NULL;
+                proc->blockedSem = -1;
+                traceRecord(TRACE_SEMWAKE, proc->pid, SemTable[semId].handle, getpid());
+                MboxSend(proc->privateMboxId, NULL, 0);
+            }
+        }
+        MboxReceive(SemTable[semId].mbox, NULL, 0);
+    }
+
+    if (lookupProc(pid) == proc && proc->timerLevel >= 0){
+        MboxSend(wheelMbox, NULL, 0);
+        if (lookupProc(pid) == proc && proc->timerLevel >= 0){
+            wheelRemove(proc);
+            MboxSend(proc->privateMboxId, NULL, 0);
+        }
+        MboxReceive(wheelMbox, NULL, 0);
+    }
+
+    if (lookupProc(pid) == proc){
+        markSubtreeDying(proc);
+    }
+}
+
+/*
+Returns true if the current proc has been zapped or its subtree is being torn down
+*/
+int isDying(){
+    return isZapped() || getCurrentProc()->dying;
+}
+
 /*
 Reset proc fields and remove proc from parent's list of children
 */
 void cleanupProc(p3ProcPtr proc){
 
     //get the proc's parent
-    p3ProcPtr parent = getProc(proc->parentPid);
+    p3ProcPtr parent = lookupProc(proc->parentPid);
 
     //remove proc from parent's list
-    if (proc->pid == parent->children->pid){
+    if (parent == NULL){
+        //parent already gone, nothing to unlink from
+    } else if (proc->pid == parent->children->pid){
         parent->children = proc->nextChild;
     } else {
         p3ProcPtr curr = parent->children;
@@ -331,8 +761,19 @@ void cleanupProc(p3ProcPtr proc){
         prev->nextChild = proc->nextChild;
     }
 
-    //reset all fields of the child
-    parent->numKids--;
+    //leave our process group, waking any WaitGroup callers if we were the last member
+    leaveGroup(proc);
+
+    //give the PTE back for reuse by a later spawn, then reset all fields of the child
+    if (parent != NULL){
+        parent->numKids--;
+    }
+    while (proc->exitedKids != NULL){
+        exitRecordPtr rec = proc->exitedKids;
+        proc->exitedKids = rec->next;
+        free(rec);
+    }
+    freeProc(proc);
     proc->pid = -1;
     proc->status = EMPTY;
     proc->parentPid = -1;
@@ -340,20 +781,126 @@ void cleanupProc(p3ProcPtr proc){
     proc->children = NULL;
     proc->nextChild = NULL;
     proc->numKids = 0;
+    proc->dying = 0;
+    proc->blockedSem = -1;
+    proc->killed = 0;
+    proc->detached = 0;
+    proc->worker = 0;
 }
 
 /*
-Initialize the proc table fields, and create the mailboxes
-needed by the procs. 
+Initialize the proc table with its first slab of PTEs. The table grows
+a slab at a time as spawns need more, so phase3 has no fixed limit on
+procs of its own; fork1 still fails once phase1's table is full.
 */
 void initProcTable(){
-    for (int i = 0; i < MAXPROC; i++){
-        ProcTable[i].status = EMPTY;
-        ProcTable[i].privateMboxId = MboxCreate(0,0);
-        ProcTable[i].spawnMboxId = MboxCreate(1,0);
-        ProcTable[i].children = NULL;
-        ProcTable[i].nextChild = NULL;
+    for (int i = 0; i < PROCHASHSIZE; i++){
+        ProcHash[i] = NULL;
+    }
+    allocProcSlab();
+}
+
+/*
+Allocates another slab of PTEs, creating the mailboxes each proc needs, and
+puts them on the free list. Returns -1 if out of memory or mailboxes, leaving
+the table as it was.
+*/
+int allocProcSlab(){
+    p3ProcPtr slab = calloc(PROCSLAB, sizeof(p3Proc));
+    if (slab == NULL){
+        return -1;
+    }
+
+    //create every mailbox before linking any PTE in, so a failure can still back out
+    for (int i = 0; i < PROCSLAB; i++){
+        slab[i].privateMboxId = MboxCreate(0,0);
+        slab[i].spawnMboxId = MboxCreate(1,0);
+        if (slab[i].privateMboxId < 0 || slab[i].spawnMboxId < 0){
+            freeProcSlab(slab, i + 1);
+            return -1;
+        }
+    }
+
+    p3ProcPtr * slabs = realloc(ProcSlabs, (numProcSlabs + 1) * sizeof(p3ProcPtr));
+    if (slabs == NULL){
+        freeProcSlab(slab, PROCSLAB);
+        return -1;
+    }
+    ProcSlabs = slabs;
+
+    //push in reverse so the free list hands out low indexes first
+    for (int i = PROCSLAB - 1; i >= 0; i--){
+        slab[i].index = numProcSlabs * PROCSLAB + i;
+        slab[i].status = EMPTY;
+        slab[i].pid = -1;
+        slab[i].parentPid = -1;
+        slab[i].blockedSem = -1;
+        slab[i].pgid = -1;
+        slab[i].nextFree = freeProcs;
+        freeProcs = &slab[i];
+    }
+    ProcSlabs[numProcSlabs] = slab;
+    numProcSlabs++;
+    return 0;
+}
+
+/*
+Releases the mailboxes of the first count PTEs of a slab that allocProcSlab
+could not finish, then frees the slab
+*/
+void freeProcSlab(p3ProcPtr slab, int count){
+    for (int i = 0; i < count; i++){
+        if (slab[i].privateMboxId >= 0){
+            MboxRelease(slab[i].privateMboxId);
+        }
+        if (slab[i].spawnMboxId >= 0){
+            MboxRelease(slab[i].spawnMboxId);
+        }
+    }
+    free(slab);
+}
+
+/*
+Takes a PTE off the free list, growing the table if it is empty. Returns NULL
+if the table cannot grow. The PTE is not findable by pid until initProc.
+*/
+p3ProcPtr newProc(){
+    if (freeProcs == NULL && allocProcSlab() < 0){
+        return NULL;
+    }
+    p3ProcPtr proc = freeProcs;
+    freeProcs = proc->nextFree;
+    proc->nextFree = NULL;
+    return proc;
+}
+
+/*
+Removes a PTE from ProcHash, if it is there, and puts it back on the free list.
+Must be called before the PTE's pid is reset.
+*/
+void freeProc(p3ProcPtr proc){
+    if (proc->pid >= 0){
+        p3ProcPtr * link = &ProcHash[proc->pid % PROCHASHSIZE];
+        while (*link != NULL && *link != proc){
+            link = &(*link)->nextHash;
+        }
+        if (*link == proc){
+            *link = proc->nextHash;
+        }
+    }
+    proc->nextHash = NULL;
+    proc->nextFree = freeProcs;
+    freeProcs = proc;
+}
+
+/*
+Returns the PTE at the given index in the table, NULL if past the end
+*/
+p3ProcPtr procAt(int index){
+    if (index < 0 || index >= numProcSlabs * PROCSLAB){
+        return NULL;
     }
+    return &ProcSlabs[index / PROCSLAB][index % PROCSLAB];
 }
 
 /*
@@ -365,366 +912,2491 @@ void initSemTable(){
         SemTable[i].status = EMPTY;
         SemTable[i].mbox = MboxCreate(1,0);
         SemTable[i].zapped = 0;
+        SemTable[i].generation = 0;
+        SemTable[i].handle = -1;
     }
 }
 
 /*
-Initialize the system call vector to call our functions
-or nullsys3.
+Initialize the pool and job tables, giving each job a 1 slot mailbox
+for its completion. Pool job queues are created by poolcreate.
 */
-void initSyscallVec(){
-    for (int i = 0; i < MAXSYSCALLS; i++){
-        systemCallVec[i] = nullsys3;
+void initPoolTable(){
+    for (int i = 0; i < MAXPOOLS; i++){
+        PoolTable[i].status = EMPTY;
+        PoolTable[i].ownerPid = -1;
+        PoolTable[i].numWorkers = 0;
+        PoolTable[i].jobMboxId = -1;
+    }
+    for (int i = 0; i < MAXPOOLJOBS; i++){
+        PoolJobTable[i].status = EMPTY;
+        PoolJobTable[i].poolId = -1;
+        PoolJobTable[i].doneMboxId = MboxCreate(1,0);
+        PoolJobTable[i].waiting = 0;
     }
-    systemCallVec[SYS_SPAWN] = spawn;
-    systemCallVec[SYS_WAIT] = wait;
-    systemCallVec[SYS_TERMINATE] = terminate;
-    systemCallVec[SYS_GETTIMEOFDAY] = gettimeofday;
-    systemCallVec[SYS_CPUTIME] = cputime;
-    systemCallVec[SYS_GETPID] = getpid3;
-    systemCallVec[SYS_SEMCREATE] = semcreate;
-    systemCallVec[SYS_SEMP] = semp;
-    systemCallVec[SYS_SEMV] = semv;
-    systemCallVec[SYS_SEMFREE] = semfree;
 }
 
 /*
-Called by the syscalls that we did not implement in phase3
+Initialize the group table, giving each group a mailbox that WaitGroup callers block on.
 */
-void nullsys3(USLOSS_Sysargs *args){
-    //just terminate
-   terminateReal(1);
-} /* nullsys */
+void initGroupTable(){
+    for (int i = 0; i < MAXGROUPS; i++){
+        GroupTable[i].status = EMPTY;
+        GroupTable[i].pgid = -1;
+        GroupTable[i].members = NULL;
+        GroupTable[i].numMembers = 0;
+        GroupTable[i].waitMboxId = MboxCreate(MAXPROC, 0);
+        GroupTable[i].numWaiters = 0;
+    }
+}
 
 /*
-Syscall function, error checks and calls spawnReal
-Input
-    arg1: address of the function to spawn.
-    arg2: parameter passed to spawned function.
-    arg3: stack size (in bytes).
-    arg4: priority.
-    arg5: character string containing process’s name.
-
-Output: 
-    arg1: the PID of the newly created process; -1 if a process could not be created.
-    arg4: -1 if illegal values are given as input; 0 otherwise.
+Initialize the system call vector to call our functions
+or nullsys3, through syscallDispatch.
 */
-void spawn(USLOSS_Sysargs *args){
-    //call spawnReal with proper args char *name, int (*func)(char *), char *arg, long stack_size, long priority
-    int (*func)(char *) = args->arg1;
-    char * arg = args->arg2;
-    int stack_size = (uintptr_t) args->arg3; //TODO: change to pointer, dereference
-    int priority = (uintptr_t) args->arg4;
-    char * name = args->arg5;
-
-    long errorcode = 0;
-    //error checks
-    if (name == NULL || func == NULL){
-        errorcode = -1;
-    }
-    if (name != NULL && (strlen(name) >= MAXNAME - 1)){
-        errorcode = -1;
-    }
-    if (stack_size < USLOSS_MIN_STACK){
-        errorcode = -1;
+void initSyscallVec(){
+    for (int i = 0; i < MAXSYSCALLS; i++){
+        systemCallVec[i] = syscallDispatch;
+        syscallTable[i] = nullsys3;
     }
-    if (priority > 6 || priority < 1) {
-        errorcode = -1;
+    syscallTable[SYS_SPAWN] = spawn;
+    syscallTable[SYS_WAIT] = wait;
+    syscallTable[SYS_TERMINATE] = terminate;
+    syscallTable[SYS_GETTIMEOFDAY] = gettimeofday;
+    syscallTable[SYS_CPUTIME] = cputime;
+    syscallTable[SYS_GETPID] = getpid3;
+    syscallTable[SYS_SEMCREATE] = semcreate;
+    syscallTable[SYS_SEMP] = semp;
+    syscallTable[SYS_SEMV] = semv;
+    syscallTable[SYS_SEMFREE] = semfree;
+    syscallTable[SYS_POOLCREATE] = poolcreate;
+    syscallTable[SYS_POOLSUBMIT] = poolsubmit;
+    syscallTable[SYS_POOLWAIT] = poolwait;
+    syscallTable[SYS_POOLNEXT] = poolnext;
+    syscallTable[SYS_SETPGID] = setpgid;
+    syscallTable[SYS_KILLGROUP] = killgroup;
+    syscallTable[SYS_WAITGROUP] = waitgroup;
+    syscallTable[SYS_SPAWNDETACHED] = spawndetached;
+    syscallTable[SYS_WAITEX] = waitex;
+    syscallTable[SYS_SPAWNARGS] = spawnargs;
+    syscallTable[SYS_SPAWNNOTIFY] = spawnnotify;
+    syscallTable[SYS_SYSCALLBATCH] = syscallbatch;
+    syscallTable[SYS_RINGSETUP] = ringsetup;
+    syscallTable[SYS_RINGENTER] = ringenter;
+    syscallTable[SYS_GETSTATS] = getstats;
+    syscallTable[SYS_TRACEDRAIN] = tracedrain;
+    syscallTable[SYS_PROFCONTROL] = profcontrol;
+    syscallTable[SYS_PROFDUMP] = profdump;
+    syscallTable[SYS_SNAPSHOT] = snapshot;
+    syscallTable[SYS_SLEEP] = sleep3;
+
+    int reporting[] = {SYS_SPAWN, SYS_SEMCREATE, SYS_SEMP, SYS_SEMV, SYS_SEMFREE,
+        SYS_POOLCREATE, SYS_POOLSUBMIT, SYS_POOLWAIT, SYS_POOLNEXT, SYS_SETPGID, SYS_KILLGROUP,
+        SYS_WAITGROUP, SYS_SPAWNDETACHED, SYS_WAIT, SYS_WAITEX, SYS_SPAWNARGS, SYS_SPAWNNOTIFY,
+        SYS_SYSCALLBATCH, SYS_RINGSETUP, SYS_RINGENTER, SYS_GETSTATS, SYS_TRACEDRAIN,
+        SYS_PROFCONTROL, SYS_PROFDUMP, SYS_SNAPSHOT, SYS_SLEEP};
+    for (int i = 0; i < sizeof(reporting) / sizeof(int); i++){
+        syscallReportsStatus[reporting[i]] = 1;
     }
+}
 
-
-    long result = (long)spawnReal(name, func, arg, stack_size, priority);
-    if (result < 0){
-        result = -1;
+/*
+Every entry of systemCallVec points here. Charges the syscall to the calling
+proc and then runs the phase3 function for it from syscallTable.
+*/
+void syscallDispatch(USLOSS_Sysargs *args){
+    p3ProcPtr me = getCurrentProc();
+    if (me != NULL){
+        me->usage.syscalls++;
+        perfSyscalls++;
+        if (SYSCALL_STATS){
+            SyscallStats[args->number].calls++;
+            me->curSyscall = args;
+            me->syscallStart = readClock();
+        }
     }
+    syscallTable[args->number](args);
+}
 
-    if (debugflag3){
-        USLOSS_Console("spawn(): returning result = %d, errorcode = %d\n", result, errorcode);
-    }
+/*
+Called by enterUserMode as a syscall returns, records how long the syscall
+took and whether it failed. Terminate never returns, so it is only counted.
+*/
+void syscallDone(p3ProcPtr me){
+    USLOSS_Sysargs * args = me->curSyscall;
+    me->curSyscall = NULL;
 
-    args->arg1 = (void *)result;
-    args->arg4 = (void *)errorcode;
+    syscallStats * stats = &SyscallStats[args->number];
+    if (syscallReportsStatus[args->number] && (long)args->arg4 < 0){
+        stats->errors++;
+    }
+    stats->latency[statBucket(readClock() - me->syscallStart)]++;
+}
 
-    if (isZapped()){
-        terminateReal(1);
+/*
+Returns the histogram bucket for value, the bucket i with 2^i - 1 <= value < 2^(i+1) - 1
+*/
+int statBucket(int value){
+    int bucket = 0;
+    value++;
+    while (value > 1 && bucket < STATBUCKETS - 1){
+        value >>= 1;
+        bucket++;
     }
-    enterUserMode();
+    return bucket;
 }
 
 /*
-Syscall function, error checks and call waitReal
+Syscall function, copies the kernel statistics of the given kind to the caller.
+Input
+    arg1: kind of statistics, one of the STATS_ constants.
+    arg2: address to copy them to.
+    arg3: size of the buffer at arg2 in bytes.
 Output
-    arg1: process id of the terminating child.
-    arg2: the termination code of the child.
+    arg4: -1 if the kind is unknown or the buffer is too small; 0 otherwise.
 */
-void wait(USLOSS_Sysargs *args){
-    int status;
-
-    long kidpid = (long)waitReal(&status);
-    long result = (long) status;
-
-
-    args->arg1 = (void * )kidpid;
-    args->arg2 = (void * )result;
+void getstats(USLOSS_Sysargs *args){
+    int kind = (uintptr_t)args->arg1;
+    void * buf = args->arg2;
+    long len = (long)args->arg3;
+
+    int result = -1;
+    if (buf != NULL){
+        switch (kind){
+            case STATS_SYSCALLS:
+                if (len >= sizeof(SyscallStats)){
+                    memcpy(buf, SyscallStats, sizeof(SyscallStats));
+                    result = 0;
+                }
+                break;
+            case STATS_SWITCHES:
+                result = copySwitchStats(buf, len);
+                break;
+            case STATS_WAKEUPS:
+                if (len >= sizeof(wakeupStats)){
+                    wakeupStats * stats = buf;
+                    stats->handle = -1;
+                    memcpy(stats->latency, WakeupStats, sizeof(WakeupStats));
+                    result = 0;
+                }
+                break;
+            case STATS_SEMWAKEUPS:
+                result = copySemWakeups(buf, len);
+                break;
+            case STATS_STACKS:
+                result = copyStackStats(buf, len);
+                break;
+        }
+    }
+    args->arg4 = (void *)(long)result;
 
-    if (isZapped()){
+    if (isDying()){
         terminateReal(1);
     }
     enterUserMode();
 }
 
 /*
-Syscall function, calls terminateReal
-Input
-    arg1: termination code for the process.
+Copies the switchStats of every live proc into buf, which is len bytes,
+ending the list with a pid of -1 if there is room. -1 if not even one fits.
 */
-void terminate(USLOSS_Sysargs *args){  //conditional send on our parents mailbox to wake them up
-    int status = (uintptr_t)args->arg1;
-    terminateReal(status);
-    enterUserMode();
-
-}
+int copySwitchStats(switchStats * buf, long len){
+    int max = len / sizeof(switchStats);
+    if (max < 1){
+        return -1;
+    }
+    int count = 0;
+    for (int i = 0; i < numProcSlabs * PROCSLAB && count < max; i++){
+        p3ProcPtr proc = procAt(i);
+        if (proc->status == OCCUPIED){
+            buf[count] = proc->sw;
+            buf[count].pid = proc->pid;
+            buf[count].switchIns = proc->usage.switches;
+            count++;
+        }
+    }
+    if (count < max){
+        buf[count].pid = -1;
+    }
+    return 0;
+}
+
+/*
+Copies the wakeupStats of every live semaphore into buf, which is len bytes,
+ending the list with a handle of -1 if there is room. -1 if not even one fits.
+*/
+int copySemWakeups(wakeupStats * buf, long len){
+    int max = len / sizeof(wakeupStats);
+    if (max < 1){
+        return -1;
+    }
+    int count = 0;
+    for (int i = 0; i < MAXSEMS && count < max; i++){
+        if (SemTable[i].status == OCCUPIED){
+            buf[count].handle = SemTable[i].handle;
+            memcpy(buf[count].latency, SemTable[i].wakeups, sizeof(SemTable[i].wakeups));
+            count++;
+        }
+    }
+    if (count < max){
+        buf[count].handle = -1;
+    }
+    return 0;
+}
+
+/*
+Copies the stackStats of every live proc into buf, which is len bytes,
+ending the list with a pid of -1 if there is room. -1 if not even one fits.
+*/
+int copyStackStats(stackStats * buf, long len){
+    int max = len / sizeof(stackStats);
+    if (max < 1){
+        return -1;
+    }
+    int count = 0;
+    for (int i = 0; i < numProcSlabs * PROCSLAB && count < max; i++){
+        p3ProcPtr proc = procAt(i);
+        if (proc->status == OCCUPIED){
+            buf[count].pid = proc->pid;
+            buf[count].stackSize = proc->usage.stackSize;
+            buf[count].highWater = stackHighWater(proc);
+            count++;
+        }
+    }
+    if (count < max){
+        buf[count].pid = -1;
+    }
+    return 0;
+}
+
+/*
+Syscall function, writes a snapshot of every live proc and semaphore to the caller's
+buffer in the layout described in phase3.h. Interrupts are held off for the whole
+pass, and it never blocks, so nothing can change while it is taken.
+Input
+    arg1: address of the buffer.
+    arg2: size of the buffer in bytes.
+Output
+    arg1: bytes written, or if the buffer is too small, bytes needed at that moment.
+    arg4: -1 if illegal values are given or the buffer is too small; 0 otherwise.
+*/
+void snapshot(USLOSS_Sysargs *args){
+    char * buf = args->arg1;
+    long len = (long)args->arg2;
+
+    if (buf == NULL || len < 0) { // Error check
+        args->arg1 = (void *)0;
+        args->arg4 = (void *)-1;
+        enterUserMode();
+        return;
+    }
+
+    unsigned int psr = USLOSS_PsrGet();
+    USLOSS_PsrSet(psr & ~USLOSS_PSR_CURRENT_INT);
+
+    snapHeader head;
+    head.time = readClock();
+    head.numProcs = 0;
+    head.numSems = 0;
+    for (int i = 0; i < numProcSlabs * PROCSLAB; i++){
+        head.numProcs += procAt(i)->status == OCCUPIED;
+    }
+    for (int i = 0; i < MAXSEMS; i++){
+        head.numSems += SemTable[i].status == OCCUPIED;
+    }
+    long size = sizeof(snapHeader) + head.numProcs * sizeof(snapProc) + head.numSems * sizeof(snapSem);
+
+    if (len < size) { // Buffer too small, tell the caller how big it must be
+        USLOSS_PsrSet(psr);
+        args->arg1 = (void *)size;
+        args->arg4 = (void *)-1;
+        enterUserMode();
+        return;
+    }
+
+    memcpy(buf, &head, sizeof(snapHeader));
+    snapProc * procs = (snapProc *)(buf + sizeof(snapHeader));
+    for (int i = 0, n = 0; i < numProcSlabs * PROCSLAB; i++){
+        p3ProcPtr proc = procAt(i);
+        if (proc->status != OCCUPIED){
+            continue;
+        }
+        snapProc * sp = &procs[n++];
+        sp->pid = proc->pid;
+        sp->parentPid = proc->parentPid;
+        sp->priority = proc->priority;
+        sp->blockedOn = -1;
+        sp->cpu = proc->sw.onCpu;
+        if (proc->pid == getpid()){
+            sp->state = SNAP_RUNNING;
+            sp->cpu += head.time - proc->switchedInAt;
+        }
+        else if (proc->dying || proc->killed){
+            sp->state = SNAP_DYING;
+        }
+        else if (proc->blockedSem >= 0){
+            sp->state = SNAP_SEMBLOCKED;
+            sp->blockedOn = SemTable[proc->blockedSem].handle;
+        }
+        else {
+            sp->state = SNAP_ACTIVE;
+        }
+    }
+    snapSem * sems = (snapSem *)(procs + head.numProcs);
+    for (int i = 0, n = 0; i < MAXSEMS; i++){
+        if (SemTable[i].status != OCCUPIED){
+            continue;
+        }
+        snapSem * ss = &sems[n++];
+        ss->handle = SemTable[i].handle;
+        ss->value = SemTable[i].value;
+        ss->owner = SemTable[i].creatorPid;
+        ss->waiters = 0;
+        for (p3ProcPtr p = SemTable[i].blockedList; p != NULL; p = p->nextBlocked){
+            ss->waiters++;
+        }
+    }
+
+    USLOSS_PsrSet(psr);
+
+    args->arg1 = (void *)size;
+    args->arg4 = (void *)0;
+
+    if (isDying()){
+        terminateReal(1);
+    }
+    enterUserMode();
+}
+
+/*
+Paints the caller's unused stack with STACKCANARY, only in builds with STACK_WATERMARK.
+fork1 doesn't tell us where the stack is, so its bottom is worked out from stackTop,
+recorded by spawnLaunch: stacks grow down, and phase1 uses no more than STACKSLOP
+bytes above spawnLaunch's frame. The painting stops STACKGAP bytes below our own
+frame. Called by the new proc itself.
+*/
+void paintStack(p3ProcPtr me){
+    int here;
+    if (!STACK_WATERMARK || me->stackTop == NULL || me->usage.stackSize < 2 * STACKSLOP){
+        return;
+    }
+    uintptr_t high = ((uintptr_t)&here - STACKGAP) & ~(uintptr_t)(sizeof(unsigned int) - 1);
+    uintptr_t low = ((uintptr_t)me->stackTop - me->usage.stackSize + STACKSLOP + sizeof(unsigned int) - 1)
+                    & ~(uintptr_t)(sizeof(unsigned int) - 1);
+    if (low >= high){
+        return;
+    }
+    for (unsigned int * word = (unsigned int *)low; word < (unsigned int *)high; word++){
+        *word = STACKCANARY;
+    }
+    me->stackLow = (unsigned int *)low;
+    me->stackHigh = (unsigned int *)high;
+}
+
+/*
+Returns the most bytes of proc's stack that have been in use below spawnLaunch's frame,
+found from how much of the painted area is still untouched. -1 if its stack was not painted.
+*/
+int stackHighWater(p3ProcPtr proc){
+    if (proc->stackLow == NULL){
+        return -1;
+    }
+    unsigned int * word = proc->stackLow;
+    while (word < proc->stackHigh && *word == STACKCANARY){
+        word++;
+    }
+    return (int)(proc->stackTop - (char *)word);
+}
+
+/*
+Called by the syscalls that we did not implement in phase3
+*/
+void nullsys3(USLOSS_Sysargs *args){
+    //just terminate
+   terminateReal(1);
+} /* nullsys */
+
+/*
+Syscall function, error checks and calls spawnReal
+Input
+    arg1: address of the function to spawn.
+    arg2: parameter passed to spawned function.
+    arg3: stack size (in bytes).
+    arg4: priority.
+    arg5: character string containing process’s name.
+
+Output: 
+    arg1: the PID of the newly created process; -1 if a process could not be created.
+    arg4: -1 if illegal values are given as input; 0 otherwise.
+*/
+void spawn(USLOSS_Sysargs *args){
+    //call spawnReal with proper args char *name, int (*func)(char *), char *arg, long stack_size, long priority
+    int (*func)(char *) = args->arg1;
+    char * arg = args->arg2;
+    int stack_size = (uintptr_t) args->arg3; //TODO: change to pointer, dereference
+    int priority = (uintptr_t) args->arg4;
+    char * name = args->arg5;
+
+    long errorcode = 0;
+    //error checks
+    if (name == NULL || func == NULL){
+        errorcode = -1;
+    }
+    if (name != NULL && (strlen(name) >= MAXNAME - 1)){
+        errorcode = -1;
+    }
+    if (stack_size < USLOSS_MIN_STACK){
+        errorcode = -1;
+    }
+    if (!validPriority(priority)) {
+        errorcode = -1;
+    }
+
+
+    long result = (long)spawnReal(name, func, arg, stack_size, priority);
+    if (result < 0){
+        result = -1;
+    }
+
+    TP(TPC_PROC, TP_INFO, "spawn(): returning result = %d, errorcode = %d\n", result, errorcode);
+
+    args->arg1 = (void *)result;
+    args->arg4 = (void *)errorcode;
+
+    if (isDying()){
+        terminateReal(1);
+    }
+    enterUserMode();
+}
+
+/*
+Returns 1 if priority is one a process may be spawned at, 0 otherwise. Every
+path that spawns a process checks with this, so they all accept the same range.
+*/
+int validPriority(long priority){
+    return priority >= 1 && priority <= 6;
+}
+
+/*
+Syscall function, error checks and has start2 fork the process so that it is not tied
+to the caller. The new proc is adopted by start3 and reaped by start2 when it terminates,
+so the caller never needs to Wait for it and may terminate first.
+Input and output are the same as spawn.
+*/
+void spawndetached(USLOSS_Sysargs *args){
+    detachReq req;
+    req.func = args->arg1;
+    req.arg = args->arg2;
+    req.stack_size = (uintptr_t) args->arg3;
+    req.priority = (uintptr_t) args->arg4;
+    req.name = args->arg5;
+    req.pid = -1;
+
+    //error checks
+    if (req.name == NULL || req.func == NULL || strlen(req.name) >= MAXNAME - 1 ||
+        req.stack_size < USLOSS_MIN_STACK || !validPriority(req.priority)){
+        args->arg1 = (void *)-1;
+        args->arg4 = (void *)-1;
+        enterUserMode();
+        return;
+    }
+
+    //hand the request to start2 and wait for it to fork the proc
+    reaperMsg msg;
+    msg.type = REAP_SPAWN;
+    msg.pid = getpid();
+    msg.req = &req;
+    MboxSend(reaperMboxId, &msg, sizeof(reaperMsg));
+    MboxReceive(getCurrentProc()->privateMboxId, NULL, 0);
+
+    TP(TPC_PROC, TP_INFO, "spawndetached(): start2 forked pid %d\n", req.pid);
+
+    args->arg1 = (void *)(long)req.pid;
+    args->arg4 = (void *)0;
+
+    if (isDying()){
+        terminateReal(1);
+    }
+    enterUserMode();
+}
+
+/*
+Syscall function, error checks and calls forkProc with a reference to the caller's buffer
+in place of a copied string argument. Ownership of the buffer, which must come from malloc,
+passes to the kernel: it is freed once every child it was passed to has terminated, so spawning
+with a large buffer costs the same as with a small one. The child reads len with GetArgLen.
+Input
+    arg1: address of a spawnRequest, whose arg is the buffer and len its size.
+Output
+    arg1: the PID of the newly created process; -1 if a process could not be created.
+    arg4: -1 if illegal values are given as input; 0 otherwise.
+*/
+void spawnargs(USLOSS_Sysargs *args){
+    spawnRequest * req = args->arg1;
+
+    //error checks
+    if (req == NULL || req->name == NULL || req->func == NULL || req->arg == NULL ||
+        req->len < 0 || strlen(req->name) >= MAXNAME - 1 ||
+        req->stack_size < USLOSS_MIN_STACK || !validPriority(req->priority)){
+        args->arg1 = (void *)-1;
+        args->arg4 = (void *)-1;
+        enterUserMode();
+        return;
+    }
+
+    argBufPtr buf = holdArgBuf(req->arg, req->len);
+    long result = -1;
+    if (buf != NULL){
+        result = forkProc(req->name, req->func, NULL, req->stack_size, req->priority, getpid(), 0, buf, -1);
+        if (result < 0){
+            //the spawn failed so the caller still owns the buffer, just drop the reference
+            dropArgBuf(buf, 0);
+            result = -1;
+        }
+    }
+
+    TP(TPC_PROC, TP_INFO, "spawnargs(): returning result = %d\n", result);
+
+    args->arg1 = (void *)result;
+    args->arg4 = (void *)0;
+
+    if (isDying()){
+        terminateReal(1);
+    }
+    enterUserMode();
+}
+
+/*
+Syscall function, error checks and calls forkProc for a child that does a V on the given
+semaphore when it terminates. The parent can go on with its own work and P the semaphore
+to learn that a child is finishing. The V comes just before the child quits, so a Wait
+after the P may still block briefly in join, and returns whichever child quits first.
+Exactly one Wait per P is needed to reap every notifying child.
+Input
+    arg1: address of a spawnRequest, whose notifySem is the semaphore.
+Output
+    arg1: the PID of the newly created process; -1 if a process could not be created.
+    arg4: -1 if illegal values are given as input; 0 otherwise.
+*/
+void spawnnotify(USLOSS_Sysargs *args){
+    spawnRequest * req = args->arg1;
+
+    //error checks
+    if (req == NULL || req->name == NULL || req->func == NULL || lookupSem(req->notifySem) == NULL ||
+        strlen(req->name) >= MAXNAME - 1 || req->stack_size < USLOSS_MIN_STACK ||
+        !validPriority(req->priority)){
+        args->arg1 = (void *)-1;
+        args->arg4 = (void *)-1;
+        enterUserMode();
+        return;
+    }
+
+    long result = forkProc(req->name, req->func, req->arg, req->stack_size, req->priority, getpid(), 0, NULL, req->notifySem);
+    if (result < 0){
+        result = -1;
+    }
+
+    TP(TPC_PROC, TP_INFO, "spawnnotify(): returning result = %d\n", result);
+
+    args->arg1 = (void *)result;
+    args->arg4 = (void *)0;
+
+    if (isDying()){
+        terminateReal(1);
+    }
+    enterUserMode();
+}
+
+/*
+Takes a reference to the SpawnArgs buffer at data, starting to track it if no
+other proc holds it yet. Returns NULL if out of memory.
+*/
+argBufPtr holdArgBuf(void * data, long len){
+    MboxSend(argBufMbox, NULL, 0); // Acquire mutex
+    argBufPtr buf = argBufs;
+    while (buf != NULL && buf->data != data){
+        buf = buf->next;
+    }
+    if (buf == NULL){
+        buf = malloc(sizeof(argBuf));
+        if (buf != NULL){
+            buf->data = data;
+            buf->len = len;
+            buf->refs = 0;
+            buf->next = argBufs;
+            argBufs = buf;
+        }
+    }
+    if (buf != NULL){
+        buf->refs++;
+    }
+    MboxReceive(argBufMbox, NULL, 0); // Release mutex
+    return buf;
+}
+
+/*
+Drops a reference to a SpawnArgs buffer. The last reference out stops tracking
+the buffer, and frees its data too if freeData is set.
+*/
+void dropArgBuf(argBufPtr buf, int freeData){
+    MboxSend(argBufMbox, NULL, 0); // Acquire mutex
+    buf->refs--;
+    if (buf->refs == 0){
+        argBufPtr * link = &argBufs;
+        while (*link != buf){
+            link = &(*link)->next;
+        }
+        *link = buf->next;
+        if (freeData){
+            free(buf->data);
+        }
+        free(buf);
+    }
+    MboxReceive(argBufMbox, NULL, 0); // Release mutex
+}
+
+/*
+Drops proc's reference to its SpawnArgs buffer, if it has one
+*/
+void releaseArgBuf(p3ProcPtr proc){
+    if (proc->argBuf != NULL){
+        dropArgBuf(proc->argBuf, 1);
+        proc->argBuf = NULL;
+    }
+}
+
+/*
+Syscall function, error checks and call waitReal
+Output
+    arg1: process id of the terminating child.
+    arg2: the termination code of the child.
+    arg4: -1 if the caller has no children to wait for; 0 otherwise.
+*/
+void wait(USLOSS_Sysargs *args){
+    int status = 0;
+
+    long kidpid = (long)waitReal(&status);
+    long result = (long) status;
+
+
+    args->arg1 = (void * )kidpid;
+    args->arg2 = (void * )result;
+    args->arg4 = (void *)(long)(kidpid < 0 ? -1 : 0);
+
+    if (isDying()){
+        terminateReal(1);
+    }
+    enterUserMode();
+}
+
+/*
+Syscall function, like wait but also returns the child's resource usage
+Input
+    arg3: address of a procUsage to fill in.
+Output
+    arg1: process id of the terminating child.
+    arg2: the termination code of the child.
+    arg4: -1 if the caller has no children to wait for; 0 otherwise.
+*/
+void waitex(USLOSS_Sysargs *args){
+    int status = 0;
+    procUsage usage;
+
+    long kidpid = (long)waitRealEx(&status, &usage);
+
+    args->arg1 = (void *)kidpid;
+    args->arg2 = (void *)(long)status;
+    if (args->arg3 != NULL){
+        memcpy(args->arg3, &usage, sizeof(procUsage));
+    }
+    args->arg4 = (void *)(long)(kidpid < 0 ? -1 : 0);
+
+    if (isDying()){
+        terminateReal(1);
+    }
+    enterUserMode();
+}
+
+/*
+Syscall function, calls terminateReal
+Input
+    arg1: termination code for the process.
+*/
+void terminate(USLOSS_Sysargs *args){  //conditional send on our parents mailbox to wake them up
+    int status = (uintptr_t)args->arg1;
+    terminateReal(status);
+    enterUserMode();
+
+}
+
+/*
+Returns the current time of day into the arg1 value of the sysargs struct passed to it.
+The time is according to the USLOSS simulator and not any real-world time.
+*/
+void gettimeofday(USLOSS_Sysargs *args){
+    int status = readClock();
+    if (status < 0) {
+        TP(TPC_SYSCALL, TP_ERROR, "gettimeofday(): clock device call failed.\n");
+        terminateReal(1);
+    }
+    args->arg1 = (void*)(long)status;
+    if (isDying()){
+        terminateReal(1);
+    }
+    enterUserMode();
+}
+
+/*
+Returns the current USLOSS time of day in microseconds, -1 if the clock device call fails
+*/
+int readClock(){
+    int status;
+    if (USLOSS_DeviceInput(USLOSS_CLOCK_DEV, 0, &status) != USLOSS_DEV_OK) {
+        return -1;
+    }
+    return status;
+}
+
+/*
+Fills in the shared page for the current proc and hooks the clock interrupt
+so that it stays current between switches.
+*/
+void initVdso(){
+    vdsoData.pid = getpid();
+    vdsoData.argLen = -1;
+    vdsoData.tod = readClock();
+    vdsoData.cpu = readtime();
+    vdsoData.ticks = 0;
+    prevClockHandler = USLOSS_IntVec[USLOSS_CLOCK_INT];
+    USLOSS_IntVec[USLOSS_CLOCK_INT] = vdsoClockHandler;
+}
+
+/*
+Clock interrupt handler, refreshes the shared page for the running proc and
+then passes the interrupt on, since the previous handler may switch procs.
+*/
+void vdsoClockHandler(int dev, void *arg){
+    int cpu = readtime();
+    p3ProcPtr proc = getProc(getpid());
+    if (proc != NULL && proc->status == OCCUPIED){
+        proc->vdsoCpu = cpu;
+    }
+    vdsoData.tod = readClock();
+    vdsoData.cpu = cpu;
+    vdsoData.ticks++;
+    inClockTick = 1;
+    prevClockHandler(dev, arg);
+    inClockTick = 0;
+}
+
+/*
+Appends an event to the trace ring, overwriting the oldest if it is full.
+Cheap enough to call from any kernel path; interrupts are held off while
+the slot is claimed so that handlers tracing in between can't share it.
+*/
+void traceRecord(int type, int pid, int arg1, int arg2){
+    int now = readClock();
+    unsigned int psr = USLOSS_PsrGet();
+    USLOSS_PsrSet(psr & ~USLOSS_PSR_CURRENT_INT);
+
+    if (traceTail - traceHead == TRACESIZE){
+        traceHead++;
+        traceLost++;
+    }
+    traceEvent * ev = &TraceRing[traceTail % TRACESIZE];
+    traceTail++;
+    ev->time = now;
+    ev->pid = pid;
+    ev->type = type;
+    ev->arg1 = arg1;
+    ev->arg2 = arg2;
+    if (Timeline != NULL && timelineLen < TIMELINESIZE){
+        Timeline[timelineLen++] = *ev;
+    }
+
+    USLOSS_PsrSet(psr);
+}
+
+/*
+Syscall function, moves the oldest events out of the trace ring.
+Input
+    arg1: address of an array of traceEvents.
+    arg2: number of entries in the array.
+Output
+    arg1: number of events copied.
+    arg2: number of events lost to overwriting since the last drain.
+    arg4: -1 if illegal values are given; 0 otherwise.
+*/
+void tracedrain(USLOSS_Sysargs *args){
+    traceEvent * buf = args->arg1;
+    int max = (uintptr_t)args->arg2;
+
+    if (buf == NULL || max < 0) { // Error check
+        args->arg4 = (void *)-1;
+        enterUserMode();
+        return;
+    }
+
+    unsigned int psr = USLOSS_PsrGet();
+    USLOSS_PsrSet(psr & ~USLOSS_PSR_CURRENT_INT);
+    int count = 0;
+    while (count < max && traceHead != traceTail){
+        buf[count++] = TraceRing[traceHead % TRACESIZE];
+        traceHead++;
+    }
+    int lost = traceLost;
+    traceLost = 0;
+    USLOSS_PsrSet(psr);
+
+    args->arg1 = (void *)(long)count;
+    args->arg2 = (void *)(long)lost;
+    args->arg4 = (void *)0;
+
+    if (isDying()){
+        terminateReal(1);
+    }
+    enterUserMode();
+}
+
+/*
+Syscall function, starts or stops the sampling profiler. Starting it discards any
+earlier samples and puts profClockHandler at the front of the clock interrupt chain;
+stopping it takes the handler back out, so a stopped profiler costs nothing.
+Input
+    arg1: 1 to start, 0 to stop.
+Output
+    arg4: -1 if it is already in that state; 0 otherwise.
+*/
+void profcontrol(USLOSS_Sysargs *args){
+    int start = (uintptr_t)args->arg1;
+
+    if ((start != 0) == profiling) { // Error check
+        args->arg4 = (void *)-1;
+        enterUserMode();
+        return;
+    }
+
+    unsigned int psr = USLOSS_PsrGet();
+    USLOSS_PsrSet(psr & ~USLOSS_PSR_CURRENT_INT);
+    if (start){
+        for (int i = 0; i < PROFSLOTS; i++){
+            ProfTable[i].pid = -1;
+            memset(ProfTable[i].samples, 0, sizeof(ProfTable[i].samples));
+        }
+        profDropped = 0;
+        profPrevHandler = USLOSS_IntVec[USLOSS_CLOCK_INT];
+        USLOSS_IntVec[USLOSS_CLOCK_INT] = profClockHandler;
+    }
+    else {
+        USLOSS_IntVec[USLOSS_CLOCK_INT] = profPrevHandler;
+    }
+    profiling = start != 0;
+    USLOSS_PsrSet(psr);
+
+    args->arg4 = (void *)0;
+
+    if (isDying()){
+        terminateReal(1);
+    }
+    enterUserMode();
+}
+
+/*
+Clock interrupt handler while profiling, takes one sample of the interrupted proc
+*/
+void profClockHandler(int dev, void *arg){
+    int pid = getpid();
+    int loc = PROF_KERNEL;
+    if (!(USLOSS_PsrGet() & USLOSS_PSR_PREV_MODE)){
+        loc = PROF_USER;
+    }
+    else {
+        p3ProcPtr me = getProc(pid);
+        if (me != NULL && me->curSyscall != NULL){
+            loc = me->curSyscall->number;
+        }
+    }
+
+    int slot = pid % PROFSLOTS;
+    int probes = 0;
+    while (ProfTable[slot].pid != pid && ProfTable[slot].pid != -1 && probes < PROFSLOTS){
+        slot = (slot + 1) % PROFSLOTS;
+        probes++;
+    }
+    if (probes == PROFSLOTS){
+        profDropped++;
+    }
+    else {
+        ProfTable[slot].pid = pid;
+        ProfTable[slot].samples[loc]++;
+    }
+
+    profPrevHandler(dev, arg);
+}
+
+/*
+Syscall function, copies the profile taken by the sampling profiler, one entry per pid sampled.
+Input
+    arg1: address of an array of profEntries.
+    arg2: number of entries in the array.
+Output
+    arg1: number of entries copied.
+    arg2: number of samples dropped because too many pids were sampled.
+    arg4: -1 if illegal values are given; 0 otherwise.
+*/
+void profdump(USLOSS_Sysargs *args){
+    profEntry * buf = args->arg1;
+    int max = (uintptr_t)args->arg2;
+
+    if (buf == NULL || max < 0) { // Error check
+        args->arg4 = (void *)-1;
+        enterUserMode();
+        return;
+    }
+
+    int count = 0;
+    for (int i = 0; i < PROFSLOTS && count < max; i++){
+        if (ProfTable[i].pid != -1){
+            buf[count++] = ProfTable[i];
+        }
+    }
+
+    args->arg1 = (void *)(long)count;
+    args->arg2 = (void *)(long)profDropped;
+    args->arg4 = (void *)0;
+
+    if (isDying()){
+        terminateReal(1);
+    }
+    enterUserMode();
+}
+
+/*
+Starts keeping every trace event in the timeline, if the TIMELINEENV
+environment variable names a file to write it to at shutdown
+*/
+void initTimeline(){
+    if (getenv(TIMELINEENV) != NULL){
+        Timeline = malloc(TIMELINESIZE * sizeof(traceEvent));
+        timelineLen = 0;
+    }
+}
+
+/*
+Writes the timeline as Chrome Trace Event JSON, for chrome://tracing or Perfetto.
+Each proc is a thread: a "run" slice for every interval it held the CPU, an async
+slice for every time it was blocked on a semaphore, and instant events for the rest.
+*/
+void writeTimeline(){
+    if (Timeline == NULL){
+        return;
+    }
+    FILE * out = fopen(getenv(TIMELINEENV), "w");
+    if (out == NULL){
+        USLOSS_Console("writeTimeline(): could not open %s\n", getenv(TIMELINEENV));
+        return;
+    }
+
+    int running = -1;
+    char * sep = "";
+    fprintf(out, "{\"traceEvents\":[");
+    for (int i = 0; i < timelineLen; i++){
+        traceEvent * ev = &Timeline[i];
+        switch (ev->type){
+            case TRACE_SWITCH:
+                if (running >= 0){
+                    fprintf(out, "%s\n{\"name\":\"run\",\"ph\":\"E\",\"pid\":0,\"tid\":%d,\"ts\":%d}", sep, running, ev->time);
+                    sep = ",";
+                }
+                fprintf(out, "%s\n{\"name\":\"run\",\"ph\":\"B\",\"pid\":0,\"tid\":%d,\"ts\":%d}", sep, ev->pid, ev->time);
+                running = ev->pid;
+                break;
+            case TRACE_SEMBLOCK:
+                fprintf(out, "%s\n{\"name\":\"sem %d\",\"cat\":\"block\",\"ph\":\"b\",\"id\":%d,\"pid\":0,\"tid\":%d,\"ts\":%d}",
+                        sep, ev->arg1, ev->pid, ev->pid, ev->time);
+                break;
+            case TRACE_SEMWAKE:
+                fprintf(out, "%s\n{\"name\":\"sem %d\",\"cat\":\"block\",\"ph\":\"e\",\"id\":%d,\"pid\":0,\"tid\":%d,\"ts\":%d,\"args\":{\"by\":%d}}",
+                        sep, ev->arg1, ev->pid, ev->pid, ev->time, ev->arg2);
+                break;
+            case TRACE_FORK:
+            case TRACE_SPAWN:
+                fprintf(out, "%s\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":0,\"tid\":%d,\"ts\":%d,\"args\":{\"child\":%d}}",
+                        sep, ev->type == TRACE_FORK ? "fork" : "spawn", ev->arg1, ev->time, ev->pid);
+                break;
+            case TRACE_TERMINATE:
+            case TRACE_QUIT:
+                fprintf(out, "%s\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":0,\"tid\":%d,\"ts\":%d,\"args\":{\"status\":%d}}",
+                        sep, ev->type == TRACE_QUIT ? "quit" : "terminate", ev->pid, ev->time, ev->arg1);
+                break;
+            default:
+                continue;
+        }
+        sep = ",";
+    }
+    if (running >= 0 && timelineLen > 0){
+        fprintf(out, "%s\n{\"name\":\"run\",\"ph\":\"E\",\"pid\":0,\"tid\":%d,\"ts\":%d}", sep, running, Timeline[timelineLen - 1].time);
+    }
+    fprintf(out, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    fclose(out);
+
+    free(Timeline);
+    Timeline = NULL;
+}
+
+/*
+Prints the totals runtests.sh -b compares against its baselines, if PERFENV is set.
+The syscall count is exact; the time phase3 procs held the CPU varies a little from
+run to run, which is why runtests.sh takes the median of several.
+*/
+void writePerf(){
+    if (getenv(PERFENV) == NULL){
+        return;
+    }
+    if (runningIsP3){
+        perfCpu += readClock() - lastSwitchAt;
+    }
+    USLOSS_Console("PERF cpu_us=%d syscalls=%d\n", perfCpu, perfSyscalls);
+}
+
+/*
+Called from p1_fork when phase1 creates a process
+*/
+void p3_fork(int pid){
+    traceRecord(TRACE_FORK, pid, getpid(), 0);
+}
+
+/*
+Called from p1_quit when a process quits
+*/
+void p3_quit(int pid){
+    traceRecord(TRACE_QUIT, pid, 0, 0);
+}
+
+/*
+Called from p1_switch whenever phase1 switches to a new process. Charges the interval
+that just ended to the outgoing proc and counts the switch against the incoming one,
+for those that are phase3 procs, and points the shared page at the incoming one.
+*/
+void p3_switch(int old, int new){
+    int now = readClock();
+
+    //only the switch the clock handler makes is involuntary, not later ones by the proc it let in
+    int involuntary = inClockTick;
+    inClockTick = 0;
+    if (runningIsP3){
+        perfCpu += now - lastSwitchAt;
+    }
+    lastSwitchAt = now;
+
+    p3ProcPtr prev = getProc(old);
+    if (prev != NULL && prev->status == OCCUPIED && old != new){
+        int interval = now - prev->switchedInAt;
+        prev->sw.onCpu += interval;
+        if (interval > prev->sw.longest){
+            prev->sw.longest = interval;
+        }
+        prev->sw.intervals[statBucket(interval)]++;
+        if (involuntary){
+            prev->sw.involuntary++;
+        }
+        else {
+            prev->sw.voluntary++;
+        }
+    }
+
+    p3ProcPtr proc = getProc(new);
+    runningIsP3 = proc != NULL && proc->status == OCCUPIED;
+    if (proc != NULL && proc->status == OCCUPIED){
+        proc->usage.switches++;
+        proc->switchedInAt = now;
+    }
+    traceRecord(TRACE_SWITCH, new, old, 0);
+    vdsoData.pid = new;
+    vdsoData.argLen = (proc != NULL && proc->status == OCCUPIED && proc->argBuf != NULL) ? proc->argBuf->len : -1;
+    vdsoData.tod = readClock();
+    vdsoData.cpu = (proc != NULL && proc->status == OCCUPIED) ? proc->vdsoCpu : 0;
+}
+
+/*
+Returns the amount of time the current process has spent running through arg1 of the
+sysargs struct passed into the function.
+*/
+void cputime(USLOSS_Sysargs *args){
+    args->arg1 = (void*)(long)readtime();
+    if (isDying()){
+        terminateReal(1);
+    }
+    enterUserMode();
+}
+
+/*
+Returns the current processes' PID through the arg1 field of the 
+sysargs struct passed to the functions.
+*/
+void getpid3(USLOSS_Sysargs *args){
+    args->arg1 = (void *)(long)getpid();
+    if (isDying()){
+        terminateReal(1);
+    }
+    enterUserMode();
+}
+
+/* Creates a new semaphore with an initial value as given in arg1. Returns -1 in the arg4 field if an error occurs, otherwise 0.*/
+void semcreate(USLOSS_Sysargs *args){
+    TP(TPC_SEM, TP_DEBUG, "semcreate(): called.\n");
+    int initNum = (uintptr_t)args->arg1; // Pull out the initial value of the semaphore
+
+    if (initNum < 0 || numSems >= MAXSEMS) { // Check error cases
+        args->arg4 = (void *)-1;
+        enterUserMode();
+        return;
+    }
+    else {
+        args->arg4 = 0;
+    }
+
+    args->arg1 = (void *)semcreateReal(initNum); // Do the actual creation which requires mutex
+
+    TP(TPC_SEM, TP_DEBUG, "semcreate(): test.\n");
+    if (isDying()) {
+        terminateReal(1); 
+    }
+    enterUserMode();
+}
+
+/* Does the actual work of creating a new semaphore with an initial value as given in the argument. 
+   Requires mutex to ensure no two processes attempt to create the same semaphore. */
+long semcreateReal(int val) {
+    TP(TPC_SEM, TP_DEBUG, "semcreateReal(): called.\n");
+    MboxSend(semTableMbox, NULL, 0); // Acquire mutex
+    int semId = getNextSemID(); // Get the next available id
+    SemTable[semId].status = OCCUPIED; // Initialize the new semaphore at the found ID
+    memset(SemTable[semId].wakeups, 0, sizeof(SemTable[semId].wakeups));
+    SemTable[semId].value = val;
+    SemTable[semId].creatorPid = getpid();
+    SemTable[semId].blockedList = NULL;
+    SemTable[semId].zapped = 0;
+    SemTable[semId].handle = semId + MAXSEMS * SemTable[semId].generation; // Handle encodes slot and generation
+    numSems++; // Increment number of semaphores (for error checking to not create too many)
+
+    MboxReceive(semTableMbox, NULL, 0); // Release mutex
+    return (long)SemTable[semId].handle;
+}
+
+/* Returns the next available ID in the semaphore table */
+int getNextSemID() {
+    // Loop through table until found next available semaphore
+    while (SemTable[nextSemId % MAXSEMS].status != EMPTY){
+        nextSemId = (nextSemId + 1) % MAXSEMS;
+    }
+
+    return nextSemId;
+}
+
+/* Performs a "P" operation on the semaphore given in arg1. The operation decrements the semaphores value if > 0.
+   Otherwise, it blocks until the value is > 0 and then performs the decrement. Returns -1 in arg4 field if error, else 0.
+*/
+void semp(USLOSS_Sysargs *args){
+    int handle = (uintptr_t)args->arg1; // Pull out the sem to perform the "p" operation on
+    args->arg4 = (void *)(long)sempReal(handle, SEMP_WAIT);
+
+    if (isDying()){
+        terminateReal(1);
+    }
+    wakeupDone(getCurrentProc(), handle);
+    enterUserMode();
+}
+
+/*
+Records the wakeup latency of a P that blocked and was woken by a V, as the
+proc that did the P is about to return to user mode
+*/
+void wakeupDone(p3ProcPtr me, int handle){
+    if (me == NULL || me->wokenAt < 0){
+        return;
+    }
+    int bucket = statBucket(readClock() - me->wokenAt);
+    me->wokenAt = -1;
+
+    int prio = me->priority - 1;
+    if (prio < 0 || prio >= WAKEPRIOS){
+        return;
+    }
+    WakeupStats[prio][bucket]++;
+    semPtr sem = lookupSem(handle);
+    if (sem != NULL){
+        sem->wakeups[prio][bucket]++;
+    }
+}
+
+/* Does the actual work of a "P" operation on the semaphore with the given handle. If the value is 0
+   the caller blocks until a V, unless block is SEMP_NOWAIT, in which case nothing is done and 1 is returned.
+   Returns -1 if the handle is not valid, else 0. Terminates the caller if it is zapped while blocked, or if
+   the semaphore is freed while blocked and block is SEMP_WAIT; with SEMP_WAITRETURN -1 is returned instead.
+*/
+int sempReal(int handle, int block){
+    if (lookupSem(handle) == NULL) { // Error check before touching the table
+        return -1;
+    }
+    int semId = handle % MAXSEMS;
+    int mboxId = SemTable[semId].mbox; // Get the semaphore's mailbox
+    MboxSend(mboxId, NULL, 0);         // Acquire mutex - don't want another process trying to modify the value at the same time
+
+    if (lookupSem(handle) == NULL) { // Error check, the semaphore may have been freed while we waited for the mutex
+        MboxReceive(mboxId, NULL, 0);
+        return -1;
+    }
+
+    if (SemTable[semId].value > 0) {
+        SemTable[semId].value--; // Simple case where we can simply decrement the semaphore's valye
+    }
+    else if (block == SEMP_NOWAIT) { // Caller doesn't want to wait
+        MboxReceive(mboxId, NULL, 0);
+        return 1;
+    }
+    else { // Complex case where we need to block
+        // Add this process to the semaphore blocked list
+        p3ProcPtr myProc = getCurrentProc();
+        if (SemTable[semId].blockedList == NULL) {
+            SemTable[semId].blockedList = myProc; // Setting as head if list is empty
+        }
+        else { // Appending to non-empty list
+            p3ProcPtr curr = SemTable[semId].blockedList;
+            p3ProcPtr prev = NULL;
+            while (curr != NULL){
+                prev = curr;
+                curr = curr->nextBlocked;
+            }
+            prev->nextBlocked = myProc;
+        }
+        myProc->blockedSem = semId;
+        myProc->wokenAt = -1;
+        traceRecord(TRACE_SEMBLOCK, myProc->pid, handle, 0);
+        TP(TPC_SEM, TP_INFO, "semp(): must block current proc on semaphore as value = %d.\n", SemTable[semId].value);
+        MboxReceive(mboxId, NULL, 0); // Release mutex on this semaphore for others
+        MboxReceive(myProc->privateMboxId, NULL, 0); // block awaiting a V()
+        TP(TPC_SEM, TP_INFO, "semp(): process %d awoken from block.\n", getpid());
+        if (isDying()){ // Check to see if we were zapped or our subtree is dying while blocked
+            terminateReal(1);
+        }
+        if (SemTable[semId].zapped || lookupSem(handle) == NULL){ // The semaphore was released while we were blocked
+            if (block == SEMP_WAIT){
+                terminateReal(1);
+            }
+            return -1;
+        }
+        return 0;
+    }
+    
+    MboxReceive(mboxId, NULL, 0); // Release mutex
+    return 0;
+}
+
+/* Performs a "V" operation on the semaphore given in arg1. The operation increments the semaphores value.
+   If other processes are blocked on a "P" operation for the same semaphore, it wakes the first one up.
+   Returns -1 in arg4 field if error, else 0.
+*/
+void semv(USLOSS_Sysargs *args){
+    int handle = (uintptr_t)args->arg1; // Pull out semaphore ID from the args
+    args->arg4 = (void *)(long)semvReal(handle);
+
+    if (isDying()){
+        terminateReal(1);
+    }
+    enterUserMode();
+}
+
+/* Does the actual work of a "V" operation on the semaphore with the given handle. Also used by
+   terminateReal to notify a SpawnNotify parent. Returns -1 if the handle is not valid, else 0.
+*/
+int semvReal(int handle){
+    if (lookupSem(handle) == NULL) { // Check for errors before touching the table
+        return -1;
+    }
+    int semId = handle % MAXSEMS;
+    int mbodId = SemTable[semId].mbox; // Get the mbox for this semaphore
+    MboxSend(mbodId, NULL, 0); // Acquire mutex
+
+    // Check for errors, the semaphore may have been freed while we waited for the mutex
+    if (lookupSem(handle) == NULL) { 
+        MboxReceive(mbodId, NULL, 0);
+        return -1;
+    }
+
+    if (SemTable[semId].blockedList == NULL) { // Simple case, no one is blocked on a "P" so simply increment sem's value
+        TP(TPC_SEM, TP_INFO, "semv(): incrementing semaphore.\n");
+        SemTable[semId].value++;
+    } 
+    else { // Other proc(s) are blocked on "P" operation so wake the first up
+        TP(TPC_SEM, TP_INFO, "semv(): waking up blocked proc.\n");
+        p3ProcPtr wakeup = SemTable[semId].blockedList;
+        int wakeupId = wakeup->privateMboxId; // Get the ID of the process to wake up
+        SemTable[semId].blockedList = wakeup->nextBlocked; // Remove it from the queue of blocked processes
+        wakeup->nextBlocked = NULL;
+        wakeup->blockedSem = -1;
+        traceRecord(TRACE_SEMWAKE, wakeup->pid, handle, getpid());
+        wakeup->wokenAt = readClock();
+        MboxSend(wakeupId, NULL, 0); // Wake up the blocked process
+    }
+    
+    MboxReceive(mbodId, NULL, 0); // Release mutex
+    return 0;
+}
+
+/* Frees the semaphore, removing it from the semaphore table and terminating all of the processes blocked on it.
+   Semaphore to free is provided in arg1. arg4 will return -1 if error, 1 if freeing cause blocked processes to be killed,
+   and 0 otherwise.
+*/
+void semfree(USLOSS_Sysargs *args){
+    int handle = (uintptr_t)args->arg1; // Pull out the semaphore ID
+    args->arg4 = (void *)(long)semfreeReal(handle);
+
+    if (isDying()){
+        terminateReal(1);
+    }
+    enterUserMode();
+}
+
+/* Does the actual work of freeing the semaphore with the given handle. Returns -1 if the handle
+   is not valid, 1 if blocked processes were terminated, and 0 otherwise.
+*/
+int semfreeReal(int handle){
+    int result;
+    if (lookupSem(handle) == NULL) { // Error check before touching the table
+        return -1;
+    }
+    int semId = handle % MAXSEMS;
+    int mboxId = SemTable[semId].mbox; // Get the mailbox for this semaphore
+    MboxSend(mboxId, NULL, 0); // Acquire mutex
+
+    if (lookupSem(handle) == NULL) { // Error check, someone else freed it while we waited for the mutex
+        MboxReceive(mboxId, NULL, 0);
+        return -1;
+    }
+    else if (SemTable[semId].blockedList != NULL) { // Set return value to 1 if blocked processes will be terminated
+        result = 1;
+    }
+    else {
+        result = 0;
+    }
+
+    // Terminate processes blocked on this semaphore if any
+    if (SemTable[semId].blockedList != NULL) {
+        TP(TPC_SEM, TP_INFO, "semfree(): terminating all procs blocked on this semaphore.\n");
+        SemTable[semId].zapped = 1; // Mark this semaphore as being freed so blocked procs know to terminate selves
+        p3ProcPtr curr = SemTable[semId].blockedList;
+        while (curr != NULL) { // Loop through the list waking up all of the blocked processes
+            p3ProcPtr temp = curr;
+            curr = curr->nextBlocked;
+            temp->nextBlocked = NULL;
+            temp->blockedSem = -1;
+            traceRecord(TRACE_SEMWAKE, temp->pid, handle, getpid());
+            MboxSend(temp->privateMboxId, NULL, 0);
+        }
+    }
+
+    // Clear out the semaphore table entry, bumping the generation so the old handle goes stale
+    SemTable[semId].status = EMPTY;
+    SemTable[semId].blockedList = NULL;
+    SemTable[semId].handle = -1;
+    SemTable[semId].generation = (SemTable[semId].generation + 1) % MAXGENERATION;
+    numSems--; // Decrement number of active semaphores
+
+    MboxReceive(mboxId, NULL, 0);
+    return result;
+}
+
+/* Creates a pool of worker processes that stay alive between jobs, so short jobs don't pay
+   for a Spawn/Terminate/Wait each. Workers are children of the caller and are torn down when it terminates.
+Input
+    arg1: number of workers.
+    arg3: stack size of each worker (in bytes).
+    arg4: priority of each worker.
+Output
+    arg1: id of the new pool.
+    arg4: -1 if illegal values are given or no pool is free; 0 otherwise.
+The workers are children of the caller, torn down with it, but Wait never returns them.
+*/
+void poolcreate(USLOSS_Sysargs *args){
+    int numWorkers = (uintptr_t)args->arg1;
+    int stack_size = (uintptr_t)args->arg3;
+    int priority = (uintptr_t)args->arg4;
+
+    TP(TPC_POOL, TP_DEBUG, "poolcreate(): called with %d workers.\n", numWorkers);
+
+    // Check error cases
+    if (numWorkers < 1 || numWorkers > MAXPOOLWORKERS || stack_size < USLOSS_MIN_STACK ||
+        !validPriority(priority)) {
+        args->arg4 = (void *)-1;
+        enterUserMode();
+        return;
+    }
+
+    MboxSend(poolTableMbox, NULL, 0); // Acquire mutex
+    int poolId = -1;
+    for (int i = 0; i < MAXPOOLS; i++){
+        if (PoolTable[i].status == EMPTY){
+            poolId = i;
+            break;
+        }
+    }
+    if (poolId < 0) { // No free pool
+        MboxReceive(poolTableMbox, NULL, 0);
+        args->arg4 = (void *)-1;
+        enterUserMode();
+        return;
+    }
+    PoolTable[poolId].status = OCCUPIED;
+    PoolTable[poolId].ownerPid = getpid();
+    PoolTable[poolId].numWorkers = 0;
+    PoolTable[poolId].jobMboxId = MboxCreate(MAXPOOLJOBS, sizeof(int));
+    MboxReceive(poolTableMbox, NULL, 0); // Release mutex
+
+    // Workers learn which pool they serve through their string argument
+    char poolArg[MAXARG];
+    snprintf(poolArg, MAXARG, "%d", poolId);
+    for (int i = 0; i < numWorkers; i++){
+        if (forkProc("poolWorker", poolWorker, poolArg, stack_size, priority, getpid(), FORK_WORKER, NULL, -1) < 0){
+            break;
+        }
+        PoolTable[poolId].numWorkers++;
+    }
+
+    args->arg1 = (void *)(long)poolId;
+    args->arg4 = (void *)(long)(PoolTable[poolId].numWorkers > 0 ? 0 : -1);
+
+    if (isDying()) {
+        terminateReal(1);
+    }
+    enterUserMode();
+}
+
+/* Queues func(arg) to be run by one of the pool's workers. Blocks only if the pool's queue is full.
+Input
+    arg1: id of the pool.
+    arg2: address of the function to run.
+    arg3: parameter passed to the function.
+Output
+    arg1: ticket to pass to PoolWait.
+    arg4: -1 if illegal values are given or no job slot is free; 0 otherwise.
+*/
+void poolsubmit(USLOSS_Sysargs *args){
+    int poolId = (uintptr_t)args->arg1;
+    int (*func)(char *) = args->arg2;
+    char * arg = args->arg3;
+
+    if (poolId < 0 || poolId >= MAXPOOLS || func == NULL) { // Error check
+        args->arg4 = (void *)-1;
+        enterUserMode();
+        return;
+    }
+
+    MboxSend(poolTableMbox, NULL, 0); // Acquire mutex
+    int ticket = -1;
+    if (PoolTable[poolId].status == OCCUPIED) {
+        for (int i = 0; i < MAXPOOLJOBS; i++){
+            if (PoolJobTable[i].status == EMPTY){
+                ticket = i;
+                break;
+            }
+        }
+    }
+    if (ticket < 0) { // Pool is gone or every job slot is in use
+        MboxReceive(poolTableMbox, NULL, 0);
+        args->arg4 = (void *)-1;
+        enterUserMode();
+        return;
+    }
+    PoolJobTable[ticket].status = OCCUPIED;
+    PoolJobTable[ticket].poolId = poolId;
+    PoolJobTable[ticket].func = func;
+    PoolJobTable[ticket].arg = arg;
+    PoolJobTable[ticket].result = 0;
+    PoolJobTable[ticket].waiting = 0;
+    int jobMboxId = PoolTable[poolId].jobMboxId;
+    MboxReceive(poolTableMbox, NULL, 0); // Release mutex
+
+    // Hand the ticket to the next idle worker
+    MboxSend(jobMboxId, &ticket, sizeof(int));
+
+    args->arg1 = (void *)(long)ticket;
+    args->arg4 = (void *)0;
+
+    if (isDying()) {
+        terminateReal(1);
+    }
+    enterUserMode();
+}
+
+/* Blocks until the job with the given ticket has finished and frees its slot.
+   Only one process may wait for a job.
+Input
+    arg1: ticket returned by PoolSubmit.
+Output
+    arg2: value returned by the job's function.
+    arg4: -1 if the ticket is not valid or already being waited for; 0 otherwise.
+*/
+void poolwait(USLOSS_Sysargs *args){
+    int ticket = (uintptr_t)args->arg1;
+
+    if (ticket < 0 || ticket >= MAXPOOLJOBS) { // Error check
+        args->arg4 = (void *)-1;
+        enterUserMode();
+        return;
+    }
+
+    MboxSend(poolTableMbox, NULL, 0); // Acquire mutex
+    poolJobPtr job = &PoolJobTable[ticket];
+    if (job->status == EMPTY || job->waiting) { // Free slot, or a second waiter that would never be woken
+        MboxReceive(poolTableMbox, NULL, 0);
+        args->arg4 = (void *)-1;
+        enterUserMode();
+        return;
+    }
+    job->waiting = 1;
+    MboxReceive(poolTableMbox, NULL, 0); // Release mutex
+
+    // Block until a worker finishes the job, leaving it for another waiter if we are zapped
+    if (MboxReceive(job->doneMboxId, NULL, 0) < 0) {
+        MboxSend(poolTableMbox, NULL, 0);
+        job->waiting = 0;
+        MboxReceive(poolTableMbox, NULL, 0);
+        terminateReal(1);
+    }
+
+    MboxSend(poolTableMbox, NULL, 0); // Acquire mutex
+    args->arg2 = (void *)(long)job->result;
+    job->status = EMPTY;
+    job->poolId = -1;
+    job->func = NULL;
+    job->arg = NULL;
+    job->waiting = 0;
+    MboxReceive(poolTableMbox, NULL, 0); // Release mutex
+    args->arg4 = (void *)0;
+
+    if (isDying()) {
+        terminateReal(1);
+    }
+    enterUserMode();
+}
+
+/* Called only by poolWorker. Reports the result of the worker's previous job, if any, and then
+   parks the worker until the next job is queued. The worker terminates if its pool is destroyed.
+Input
+    arg1: id of the pool.
+    arg3: value returned by the previous job.
+Output
+    arg1: function of the next job.
+    arg2: parameter of the next job.
+    arg4: -1 if the caller is not one of the pool's workers.
+*/
+void poolnext(USLOSS_Sysargs *args){
+    int poolId = (uintptr_t)args->arg1;
+    p3ProcPtr me = getCurrentProc();
+    int ticket;
+
+    // Only the pool's own workers may take its jobs; a worker's arg names its pool
+    if (!me->worker || me->func != poolWorker || poolId != atoi(me->arg)) {
+        args->arg4 = (void *)-1;
+        enterUserMode();
+        return;
+    }
+
+    // Post the previous job's result and wake anyone in PoolWait
+    finishPoolJob(me, (long)args->arg3);
+
+    // The pool is gone, or its slot now belongs to a pool our owner didn't create
+    if (PoolTable[poolId].status == EMPTY || PoolTable[poolId].ownerPid != me->parentPid) {
+        terminateReal(1);
+    }
+
+    // Park until a job arrives, the receive fails if the pool is destroyed
+    if (MboxReceive(PoolTable[poolId].jobMboxId, &ticket, sizeof(int)) < 0 || isDying()) {
+        TP(TPC_POOL, TP_INFO, "poolnext(): worker %d leaving pool %d\n", getpid(), poolId);
+        terminateReal(1);
+    }
+
+    MboxSend(poolTableMbox, NULL, 0); // Acquire mutex
+    if (PoolJobTable[ticket].status != OCCUPIED) { // Failed by destroyPools since we were handed it
+        MboxReceive(poolTableMbox, NULL, 0);
+        terminateReal(1);
+    }
+    PoolJobTable[ticket].status = JOB_RUNNING;
+    me->poolTicket = ticket;
+    args->arg1 = PoolJobTable[ticket].func;
+    args->arg2 = PoolJobTable[ticket].arg;
+    MboxReceive(poolTableMbox, NULL, 0); // Release mutex
+    args->arg4 = (void *)0;
+    enterUserMode();
+}
 
 /*
-Returns the current time of day into the arg1 value of the sysargs struct passed to it.
-The time is according to the USLOSS simulator and not any real-world time.
+Posts the result of the job proc is running as a pool worker, if any, and wakes
+the PoolWait caller blocked on it.
+*/
+void finishPoolJob(p3ProcPtr proc, int result){
+    if (proc->poolTicket < 0){
+        return;
+    }
+    MboxSend(poolTableMbox, NULL, 0); // Acquire mutex
+    poolJobPtr job = &PoolJobTable[proc->poolTicket];
+    job->result = result;
+    job->status = JOB_DONE;
+    MboxCondSend(job->doneMboxId, NULL, 0);
+    proc->poolTicket = -1;
+    MboxReceive(poolTableMbox, NULL, 0); // Release mutex
+}
+
+/*
+Body of every pool worker, runs in user mode. Loops forever asking the kernel
+for the next job and running it; the kernel terminates it when its pool goes away.
+*/
+int poolWorker(char * arg){
+    USLOSS_Sysargs sysArg;
+    int poolId = atoi(arg);
+    long result = 0;
+
+    while (1) {
+        sysArg.number = SYS_POOLNEXT;
+        sysArg.arg1 = (void *)(long)poolId;
+        sysArg.arg3 = (void *)result;
+        USLOSS_Syscall(&sysArg);
+
+        int (*func)(char *) = sysArg.arg1;
+        result = func(sysArg.arg2);
+    }
+
+    return 0;
+}
+
+/*
+Destroys every pool owned by the given pid. Releasing a pool's job queue wakes
+its idle workers, which then terminate themselves. Jobs already running are left
+to finish and post their own results.
+*/
+void destroyPools(int ownerPid){
+    MboxSend(poolTableMbox, NULL, 0); // Acquire mutex
+    for (int i = 0; i < MAXPOOLS; i++){
+        if (PoolTable[i].status == OCCUPIED && PoolTable[i].ownerPid == ownerPid){
+            PoolTable[i].status = EMPTY;
+            PoolTable[i].ownerPid = -1;
+            PoolTable[i].numWorkers = 0;
+            MboxRelease(PoolTable[i].jobMboxId);
+            PoolTable[i].jobMboxId = -1;
+
+            // Jobs that never ran complete with -1 so PoolWait doesn't block forever
+            for (int j = 0; j < MAXPOOLJOBS; j++){
+                if (PoolJobTable[j].status == OCCUPIED && PoolJobTable[j].poolId == i){
+                    PoolJobTable[j].result = -1;
+                    PoolJobTable[j].status = JOB_DONE;
+                    MboxCondSend(PoolJobTable[j].doneMboxId, NULL, 0);
+                }
+            }
+        }
+    }
+    MboxReceive(poolTableMbox, NULL, 0); // Release mutex
+}
+
+/* Moves a process into a process group, creating the group if it doesn't exist yet.
+   A process may only move itself or one of its children.
+Input
+    arg1: pid of the process to move, 0 for the caller.
+    arg2: id of the group to join, 0 to start a new group named after the process.
+Output
+    arg4: -1 if illegal values are given or no group is free; 0 otherwise.
+*/
+void setpgid(USLOSS_Sysargs *args){
+    int pid = (uintptr_t)args->arg1;
+    int pgid = (uintptr_t)args->arg2;
+
+    if (pid == 0) {
+        pid = getpid();
+    }
+    if (pgid == 0) {
+        pgid = pid;
+    }
+
+    p3ProcPtr proc = lookupProc(pid);
+    if (proc == NULL || pgid < 0 || (pid != getpid() && proc->parentPid != getpid())) { // Error check
+        args->arg4 = (void *)-1;
+        enterUserMode();
+        return;
+    }
+
+    leaveGroup(proc);
+    joinGroup(proc, pgid);
+    args->arg4 = (void *)(long)(proc->pgid == pgid ? 0 : -1);
+
+    if (isDying()) {
+        terminateReal(1);
+    }
+    enterUserMode();
+}
+
+/* Terminates every member of a process group, along with their subtrees. Members blocked on a
+   semaphore are woken right away; the rest terminate the next time they enter the kernel.
+   Returns without waiting, use WaitGroup to wait for the members to be gone.
+Input
+    arg1: id of the group.
+    arg2: termination code for the members.
+Output
+    arg4: -1 if the group does not exist; 0 otherwise.
+*/
+void killgroup(USLOSS_Sysargs *args){
+    int pgid = (uintptr_t)args->arg1;
+    int status = (uintptr_t)args->arg2;
+
+    MboxSend(groupTableMbox, NULL, 0); // Acquire mutex
+    groupPtr grp = getGroup(pgid, 0);
+    if (grp == NULL) { // Error check
+        MboxReceive(groupTableMbox, NULL, 0);
+        args->arg4 = (void *)-1;
+        enterUserMode();
+        return;
+    }
+
+    TP(TPC_GROUP, TP_INFO, "killgroup(): killing %d members of group %d\n", grp->numMembers, pgid);
+
+    // Mark every member before waking any, so members can't spawn new children into the group unnoticed
+    int members[MAXPROC];
+    int numMembers = 0;
+    for (p3ProcPtr curr = grp->members; curr != NULL; curr = curr->nextInGroup) {
+        curr->killed = 1;
+        curr->killStatus = status;
+        if (numMembers < MAXPROC) {
+            members[numMembers++] = curr->pid;
+        }
+    }
+    MboxReceive(groupTableMbox, NULL, 0); // Release mutex
+
+    // Markers take the semaphore mutexes, so wake the members outside the group mutex. A member
+    // can quit while markDying blocks and its PTE be reused, so each is looked up again by pid.
+    // The list is newest first, wake the members in the order they joined.
+    for (int i = numMembers - 1; i >= 0; i--) {
+        p3ProcPtr proc = lookupProc(members[i]);
+        if (proc != NULL && proc->pgid == pgid && proc->killed && !proc->dying) {
+            markDying(proc);
+        }
+    }
+    args->arg4 = (void *)0;
+
+    if (isDying()) {
+        terminateReal(1);
+    }
+    enterUserMode();
+}
+
+/* Blocks until every member of a process group has terminated.
+Input
+    arg1: id of the group.
+Output
+    arg4: -1 if the group does not exist; 0 otherwise.
+*/
+void waitgroup(USLOSS_Sysargs *args){
+    int pgid = (uintptr_t)args->arg1;
+
+    MboxSend(groupTableMbox, NULL, 0); // Acquire mutex
+    groupPtr grp = getGroup(pgid, 0);
+    if (grp == NULL) { // Error check, an empty group no longer exists so there is nothing to wait for
+        MboxReceive(groupTableMbox, NULL, 0);
+        args->arg4 = (void *)-1;
+        enterUserMode();
+        return;
+    }
+    grp->numWaiters++;
+    int waitMboxId = grp->waitMboxId;
+    MboxReceive(groupTableMbox, NULL, 0); // Release mutex
+
+    MboxReceive(waitMboxId, NULL, 0); // Block until the last member leaves
+    args->arg4 = (void *)0;
+
+    if (isDying()) {
+        terminateReal(1);
+    }
+    enterUserMode();
+}
+
+/*
+Returns the group table entry for pgid, or NULL if there is none. If create is set,
+a free entry is claimed for the group instead of returning NULL. Caller holds the group mutex.
+*/
+groupPtr getGroup(int pgid, int create){
+    groupPtr freeGroup = NULL;
+    for (int i = 0; i < MAXGROUPS; i++){
+        if (GroupTable[i].status == OCCUPIED && GroupTable[i].pgid == pgid){
+            return &GroupTable[i];
+        }
+        if (freeGroup == NULL && GroupTable[i].status == EMPTY){
+            freeGroup = &GroupTable[i];
+        }
+    }
+    if (!create || freeGroup == NULL){
+        return NULL;
+    }
+    freeGroup->status = OCCUPIED;
+    freeGroup->pgid = pgid;
+    freeGroup->members = NULL;
+    freeGroup->numMembers = 0;
+    freeGroup->numWaiters = 0;
+    return freeGroup;
+}
+
+/*
+Adds proc to the front of the membership list of group pgid
+*/
+void joinGroup(p3ProcPtr proc, int pgid){
+    MboxSend(groupTableMbox, NULL, 0); // Acquire mutex
+    groupPtr grp = getGroup(pgid, 1);
+    if (grp != NULL){
+        proc->pgid = pgid;
+        proc->nextInGroup = grp->members;
+        grp->members = proc;
+        grp->numMembers++;
+    }
+    MboxReceive(groupTableMbox, NULL, 0); // Release mutex
+}
+
+/*
+Removes proc from its group's membership list. The last member out frees the
+group and wakes everyone blocked in WaitGroup on it.
+*/
+void leaveGroup(p3ProcPtr proc){
+    if (proc->pgid < 0){
+        return;
+    }
+    MboxSend(groupTableMbox, NULL, 0); // Acquire mutex
+    groupPtr grp = getGroup(proc->pgid, 0);
+    if (grp != NULL){
+        if (grp->members == proc){
+            grp->members = proc->nextInGroup;
+        } else {
+            p3ProcPtr curr = grp->members;
+            while (curr != NULL && curr->nextInGroup != proc){
+                curr = curr->nextInGroup;
+            }
+            if (curr != NULL){
+                curr->nextInGroup = proc->nextInGroup;
+            }
+        }
+        grp->numMembers--;
+
+        if (grp->numMembers == 0){
+            for (int i = 0; i < grp->numWaiters; i++){
+                MboxCondSend(grp->waitMboxId, NULL, 0);
+            }
+            grp->numWaiters = 0;
+            grp->status = EMPTY;
+            grp->pgid = -1;
+        }
+    }
+    proc->pgid = -1;
+    proc->nextInGroup = NULL;
+    MboxReceive(groupTableMbox, NULL, 0); // Release mutex
+}
+
+/* Runs a vector of ordinary syscalls in one kernel entry, in order, filling in each entry's
+   outputs as if it had been made on its own. Stops before the first entry that would block,
+   terminate the caller, or is not supported in a batch, so none of them ever blocks.
+Input
+    arg1: address of an array of USLOSS_Sysargs.
+    arg2: number of entries.
+Output
+    arg1: number of entries completed; entry arg1 is the one that stopped the batch, if any.
+    arg4: -1 if illegal values are given as input; 0 otherwise.
+*/
+void syscallbatch(USLOSS_Sysargs *args){
+    USLOSS_Sysargs * vec = args->arg1;
+    int n = (uintptr_t)args->arg2;
+
+    if (vec == NULL || n < 0) { // Error check
+        args->arg1 = (void *)0;
+        args->arg4 = (void *)-1;
+        enterUserMode();
+        return;
+    }
+
+    int done = 0;
+    while (done < n && batchOne(&vec[done]) == 0) {
+        done++;
+    }
+
+    TP(TPC_SYSCALL, TP_INFO, "syscallbatch(): completed %d of %d\n", done, n);
+
+    args->arg1 = (void *)(long)done;
+    args->arg4 = (void *)0;
+
+    if (isDying()) {
+        terminateReal(1);
+    }
+    enterUserMode();
+}
+
+/*
+Does the work of one SyscallBatch entry by calling the same kernel functions as the
+syscall would, without its return to user mode. Returns 0 if the entry was completed,
+or 1 if it would block or isn't supported in a batch and was left alone.
+*/
+int batchOne(USLOSS_Sysargs *args){
+    int value;
+
+    switch (args->number) {
+        case SYS_SPAWN:
+            if (args->arg1 == NULL || args->arg5 == NULL || strlen(args->arg5) >= MAXNAME - 1 ||
+                (uintptr_t)args->arg3 < USLOSS_MIN_STACK || !validPriority((uintptr_t)args->arg4)) {
+                args->arg1 = (void *)-1;
+                args->arg4 = (void *)-1;
+                return 0;
+            }
+            value = spawnReal(args->arg5, args->arg1, args->arg2, (uintptr_t)args->arg3, (uintptr_t)args->arg4);
+            args->arg1 = (void *)(long)(value < 0 ? -1 : value);
+            args->arg4 = (void *)0;
+            return 0;
+        case SYS_SEMCREATE:
+            value = (uintptr_t)args->arg1;
+            if (value < 0 || numSems >= MAXSEMS) {
+                args->arg4 = (void *)-1;
+                return 0;
+            }
+            args->arg1 = (void *)semcreateReal(value);
+            args->arg4 = (void *)0;
+            return 0;
+        case SYS_SEMP:
+            value = sempReal((uintptr_t)args->arg1, SEMP_NOWAIT);
+            if (value == 1) { // would block
+                return 1;
+            }
+            args->arg4 = (void *)(long)value;
+            return 0;
+        case SYS_SEMV:
+            args->arg4 = (void *)(long)semvReal((uintptr_t)args->arg1);
+            return 0;
+        case SYS_SEMFREE:
+            args->arg4 = (void *)(long)semfreeReal((uintptr_t)args->arg1);
+            return 0;
+        case SYS_GETPID:
+            args->arg1 = (void *)(long)getpid();
+            return 0;
+        case SYS_GETTIMEOFDAY:
+            args->arg1 = (void *)(long)readClock();
+            return 0;
+        case SYS_CPUTIME:
+            args->arg1 = (void *)(long)readtime();
+            return 0;
+        default: // Wait and the pool calls may block, Terminate never returns
+            return 1;
+    }
+}
+
+/* Suspends the caller for at least the given time. Sleeps are rounded up to whole
+   TICK_US ticks and end on the first clock interrupt the clock daemon sees after that.
+Input
+    arg1: seconds to sleep.
+    arg2: further microseconds to sleep.
+Output
+    arg4: -1 if illegal values are given or the clock daemon could not be started; 0 otherwise.
 */
-void gettimeofday(USLOSS_Sysargs *args){
-    int status;
-    int result = USLOSS_DeviceInput(USLOSS_CLOCK_DEV, 0, &status);
-    if (result != USLOSS_DEV_OK) {
-        if (debugflag3) {
-            USLOSS_Console("gettimeofday(): clock device call failed.\n");
-        }
-        terminateReal(1);
+void sleep3(USLOSS_Sysargs *args){
+    long seconds = (long)args->arg1;
+    long us = (long)args->arg2;
+
+    if (seconds < 0 || us < 0) { // Error check
+        args->arg4 = (void *)-1;
+        enterUserMode();
+        return;
     }
-    args->arg1 = (void*)(long)status;
-    if (isZapped()){
+
+    args->arg4 = (void *)(long)sleepReal(seconds * 1000000 + us);
+
+    if (isDying()){
         terminateReal(1);
     }
     enterUserMode();
 }
 
 /*
-Returns the amount of time the current process has spent running through arg1 of the
-sysargs struct passed into the function.
+Does the work of sleep3, the caller blocks on its private mailbox on the timer
+wheel until the clock daemon reaches its tick. Returns -1 if there is no daemon, else 0.
 */
-void cputime(USLOSS_Sysargs *args){
-    args->arg1 = (void*)(long)readtime();
-    if (isZapped()){
-        terminateReal(1);
+int sleepReal(long us){
+    if (us <= 0 || isDying()){
+        return 0;
     }
-    enterUserMode();
+    if (clockDaemonPid < 0 && startClockDaemon() < 0){
+        return -1;
+    }
+    p3ProcPtr me = getCurrentProc();
+
+    MboxSend(wheelMbox, NULL, 0); // Acquire mutex
+    me->wakeTick = (readClock() + us + TICK_US - 1) / TICK_US; // first tick at or after now + us
+    if (me->wakeTick <= wheelTick){ // this tick's slot has already been expired
+        me->wakeTick = wheelTick + 1;
+    }
+    wheelAdd(me);
+    MboxReceive(wheelMbox, NULL, 0); // Release mutex
+
+    MboxReceive(me->privateMboxId, NULL, 0); // block until the daemon or markDying wakes us
+    return 0;
 }
 
 /*
-Returns the current processes' PID through the arg1 field of the 
-sysargs struct passed to the functions.
+Has start2 fork the clock daemon, if no one has yet, and waits until it has.
+The wheel is held meanwhile so that sleepers racing to be first wait for the result.
+Returns -1 if it could not be forked, else 0.
 */
-void getpid3(USLOSS_Sysargs *args){
-    args->arg1 = (void *)(long)getpid();
-    if (isZapped()){
-        terminateReal(1);
+int startClockDaemon(){
+    MboxSend(wheelMbox, NULL, 0); // Acquire mutex
+    if (clockDaemonPid < 0){
+        if (wheelTick < 0){
+            wheelTick = readClock() / TICK_US;
+        }
+        reaperMsg msg;
+        msg.type = REAP_DAEMON;
+        msg.pid = getpid();
+        msg.req = NULL;
+        MboxSend(reaperMboxId, &msg, sizeof(reaperMsg));
+        MboxReceive(getCurrentProc()->privateMboxId, NULL, 0);
     }
-    enterUserMode();
+    int result = clockDaemonPid < 0 ? -1 : 0;
+    MboxReceive(wheelMbox, NULL, 0); // Release mutex
+    return result;
 }
 
-/* Creates a new semaphore with an initial value as given in arg1. Returns -1 in the arg4 field if an error occurs, otherwise 0.*/
-void semcreate(USLOSS_Sysargs *args){
-    if (debugflag3) {
-        USLOSS_Console("semcreate(): called.\n");
+/*
+Called by start2 to fork the clock daemon as its own child, so that it runs until
+start2 stops it at shutdown. Returns its pid, -1 if it could not be forked.
+*/
+int forkClockDaemon(){
+    p3ProcPtr kid = newProc();
+    if (kid == NULL){
+        return -1;
     }
-    int initNum = (uintptr_t)args->arg1; // Pull out the initial value of the semaphore
-
-    if (initNum < 0 || numSems >= MAXSEMS) { // Check error cases
-        args->arg4 = (void *)-1;
-        enterUserMode();
-        return;
+    char index[MAXARG];
+    snprintf(index, MAXARG, "%d", kid->index);
+    int kidpid = fork1("clockDaemon", clockDaemon, index, USLOSS_MIN_STACK, 2);
+    if (kidpid < 0){
+        freeProc(kid);
+        return -1;
     }
-    else {
-        args->arg4 = 0;
+    initProc(kid, kidpid, getpid());
+    kid->priority = 2;
+    kid->usage.stackSize = USLOSS_MIN_STACK;
+    MboxSend(kid->spawnMboxId, NULL, 0);
+    return kidpid;
+}
+
+/*
+Body of the clock daemon, runs in kernel mode. Waits on the clock device and moves the
+timer wheel up to the time it reports, waking each sleeper whose tick has come. The
+clock device reports less often than every tick, so each wait can cover several ticks.
+*/
+int clockDaemon(char * arg){
+    p3ProcPtr me = procAt(atoi(arg));
+    int status;
+
+    //wait for forkClockDaemon to finish creating pte
+    MboxReceive(me->spawnMboxId, NULL, 0);
+
+    while (waitDevice(USLOSS_CLOCK_DEV, 0, &status) == 0 && !isZapped()){
+        MboxSend(wheelMbox, NULL, 0); // Acquire mutex
+        wheelAdvance(status / TICK_US);
+        MboxReceive(wheelMbox, NULL, 0); // Release mutex
     }
 
-    args->arg1 = (void *)semcreateReal(initNum); // Do the actual creation which requires mutex
+    //zapped by start2 at shutdown
+    cleanupProc(me);
+    quit(0);
+    return 0;
+}
 
-    if (debugflag3) {
-        USLOSS_Console("semcreate(): test.\n");
+/*
+Puts proc on the timer wheel at its wakeTick, on the lowest level whose span
+from the current tick reaches it. A wakeTick of the current tick goes in the
+level 0 slot wheelAdvance expires right after cascading, so callers outside a
+cascade must give a later tick. Called with the wheel mutex held.
+*/
+void wheelAdd(p3ProcPtr proc){
+    int delta = proc->wakeTick - wheelTick;
+    if (delta < 0){ // Overdue, wake on this tick
+        proc->wakeTick = wheelTick;
+        delta = 0;
     }
-    if (isZapped()) {
-        terminateReal(1); 
+    int level = 0;
+    while (level < WHEELLEVELS - 1 && delta >= (1 << (WHEELBITS * (level + 1)))){
+        level++;
     }
-    enterUserMode();
+    int slot = (proc->wakeTick >> (WHEELBITS * level)) & WHEELMASK;
+
+    proc->timerLevel = level;
+    proc->timerSlot = slot;
+    proc->prevTimer = NULL;
+    proc->nextTimer = TimerWheel[level][slot];
+    if (proc->nextTimer != NULL){
+        proc->nextTimer->prevTimer = proc;
+    }
+    TimerWheel[level][slot] = proc;
 }
 
-/* Does the actual work of creating a new semaphore with an initial value as given in the argument. 
-   Requires mutex to ensure no two processes attempt to create the same semaphore. */
-long semcreateReal(int val) {
-    if (debugflag3) {
-        USLOSS_Console("semcreateReal(): called.\n");
+/*
+Takes proc off the timer wheel. Called with the wheel mutex held.
+*/
+void wheelRemove(p3ProcPtr proc){
+    if (proc->prevTimer != NULL){
+        proc->prevTimer->nextTimer = proc->nextTimer;
     }
-    MboxSend(semTableMbox, NULL, 0); // Acquire mutex
-    int semId = getNextSemID(); // Get the next available id
-    SemTable[semId].status = OCCUPIED; // Initialize the new semaphore at the found ID
-    SemTable[semId].value = val;
-    SemTable[semId].blockedList = NULL;
-    SemTable[semId].zapped = 0;
-    numSems++; // Increment number of semaphores (for error checking to not create too many)
+    else {
+        TimerWheel[proc->timerLevel][proc->timerSlot] = proc->nextTimer;
+    }
+    if (proc->nextTimer != NULL){
+        proc->nextTimer->prevTimer = proc->prevTimer;
+    }
+    proc->nextTimer = NULL;
+    proc->prevTimer = NULL;
+    proc->timerLevel = -1;
+}
 
-    MboxReceive(semTableMbox, NULL, 0); // Release mutex
-    return (long)semId;
+/*
+Re-adds every sleeper in a slot of a higher level, moving them down now that their
+ticks are near. Sleeps longer than the whole wheel can land back in the same slot,
+so the slot is emptied before any are re-added.
+*/
+void wheelCascade(int level, int slot){
+    p3ProcPtr proc = TimerWheel[level][slot];
+    TimerWheel[level][slot] = NULL;
+    while (proc != NULL){
+        p3ProcPtr next = proc->nextTimer;
+        wheelAdd(proc);
+        proc = next;
+    }
 }
 
-/* Returns the next available ID in the semaphore table */
-int getNextSemID() {
-    // Loop through table until found next available semaphore
-    while (SemTable[nextSemId % MAXSEMS].status != EMPTY){
-        nextSemId = (nextSemId + 1) % MAXSEMS;
+/*
+Moves the timer wheel forward one tick at a time up to target, cascading the higher
+levels as the lower ones wrap and waking the sleepers in each tick's slot, so the
+cost is the ticks passed plus the sleepers woken. Called with the wheel mutex held.
+*/
+void wheelAdvance(int target){
+    while (wheelTick < target){
+        wheelTick++;
+        for (int level = 1; level < WHEELLEVELS; level++){
+            if ((wheelTick & ((1 << (WHEELBITS * level)) - 1)) != 0){
+                break;
+            }
+            wheelCascade(level, (wheelTick >> (WHEELBITS * level)) & WHEELMASK);
+        }
+        p3ProcPtr proc;
+        while ((proc = TimerWheel[0][wheelTick & WHEELMASK]) != NULL){
+            wheelRemove(proc);
+            MboxSend(proc->privateMboxId, NULL, 0);
+        }
     }
+}
 
-    return nextSemId;
+/*
+Initialize the ring table. Each ring's mailboxes are created by ringsetup.
+*/
+void initRingTable(){
+    for (int i = 0; i < MAXRINGS; i++){
+        RingTable[i].status = EMPTY;
+        RingTable[i].ownerPid = -1;
+        RingTable[i].user = NULL;
+        RingTable[i].jobMboxId = -1;
+        RingTable[i].eventMboxId = -1;
+    }
 }
 
-/* Performs a "P" operation on the semaphore given in arg1. The operation decrements the semaphores value if > 0.
-   Otherwise, it blocks until the value is > 0 and then performs the decrement. Returns -1 in arg4 field if error, else 0.
+/* Registers a pair of submission/completion rings in the caller's memory and starts the kernel
+   workers that complete its blocking operations. Each process may have one ring; it is torn down,
+   along with its workers, when the process terminates.
+Input
+    arg1: address of the asyncRing.
+Output
+    arg4: -1 if illegal values are given, the caller already has a ring or none are free; 0 otherwise.
 */
-void semp(USLOSS_Sysargs *args){
-    int semId = (uintptr_t)args->arg1; // Pull out the sem to perform the "p" operation on
-    int mboxId = SemTable[semId].mbox; // Get the semaphore's mailbox
-    MboxSend(mboxId, NULL, 0);         // Acquire mutex - don't want another process trying to modify the value at the same time
+void ringsetup(USLOSS_Sysargs *args){
+    asyncRing * user = args->arg1;
+    p3ProcPtr me = getCurrentProc();
 
-    if (semId < 0 || semId >= MAXSEMS || SemTable[semId].status == EMPTY) { // Error check
+    if (user == NULL || me->ringId >= 0) { // Error check
         args->arg4 = (void *)-1;
+        enterUserMode();
         return;
     }
-    else {
-        args->arg4 = (void *)0;
-    }
 
-    if (SemTable[semId].value > 0) {
-        SemTable[semId].value--; // Simple case where we can simply decrement the semaphore's valye
-    }
-    else { // Complex case where we need to block
-        // Add this process to the semaphore blocked list
-        int procId = getpid();
-        p3ProcPtr myProc = &ProcTable[procId];
-        if (SemTable[semId].blockedList == NULL) {
-            SemTable[semId].blockedList = myProc; // Setting as head if list is empty
-        }
-        else { // Appending to non-empty list
-            p3ProcPtr curr = SemTable[semId].blockedList;
-            p3ProcPtr prev = NULL;
-            while (curr != NULL){
-                prev = curr;
-                curr = curr->nextBlocked;
-            }
-            prev->nextBlocked = myProc;
-        }
-        if (debugflag3){
-            USLOSS_Console("semp(): must block current proc on semaphore as value = %d.\n", SemTable[semId].value);
-        }
-        MboxReceive(mboxId, NULL, 0); // Release mutex on this semaphore for others
-        MboxReceive(myProc->privateMboxId, NULL, 0); // block awaiting a V()
-        if (debugflag3){
-            USLOSS_Console("semp(): process %d awoken from block.\n", getpid());
-        }
-        if (isZapped() || SemTable[semId].zapped){ // Check to see if we were zapped while blocked (including the semaphore was released)
-            terminateReal(1);
+    MboxSend(ringTableMbox, NULL, 0); // Acquire mutex
+    int ringId = -1;
+    for (int i = 0; i < MAXRINGS; i++){
+        if (RingTable[i].status == EMPTY){
+            ringId = i;
+            break;
         }
+    }
+    if (ringId < 0) { // No free ring
+        MboxReceive(ringTableMbox, NULL, 0);
+        args->arg4 = (void *)-1;
         enterUserMode();
         return;
     }
-    
-    MboxReceive(mboxId, NULL, 0); // Release mutex
-    if (isZapped() || SemTable[semId].zapped){
+    ringPtr rng = &RingTable[ringId];
+    rng->status = OCCUPIED;
+    rng->ownerPid = me->pid;
+    rng->user = user;
+    rng->inflight = 0;
+    rng->numWorkers = 0;
+    rng->waitHead = 0;
+    rng->numWaits = 0;
+    rng->numDeferred = 0;
+    rng->jobMboxId = MboxCreate(RINGSIZE, sizeof(ringSqe));
+    rng->eventMboxId = MboxCreate(RINGSIZE, 0);
+    user->sqHead = user->sqTail = 0;
+    user->cqHead = user->cqTail = 0;
+    me->ringId = ringId;
+    MboxReceive(ringTableMbox, NULL, 0); // Release mutex
+
+    // Workers stay in kernel mode, so they are forked directly rather than through spawnReal
+    for (int i = 0; i < RINGWORKERS; i++){
+        p3ProcPtr kid = newProc();
+        if (kid == NULL){
+            break;
+        }
+        char index[MAXARG];
+        snprintf(index, MAXARG, "%d", kid->index);
+        int kidpid = fork1("ringWorker", ringWorker, index, USLOSS_MIN_STACK, 2);
+        if (kidpid < 0){
+            freeProc(kid);
+            break;
+        }
+        initProc(kid, kidpid, me->pid);
+        kid->ringId = ringId;
+        kid->priority = 2;
+        kid->worker = 1;
+        rng->numWorkers++;
+        MboxSend(kid->spawnMboxId, NULL, 0);
+    }
+
+    args->arg4 = (void *)0;
+
+    if (isDying()) {
         terminateReal(1);
     }
     enterUserMode();
 }
 
-/* Performs a "V" operation on the semaphore given in arg1. The operation increments the semaphores value.
-   If other processes are blocked on a "P" operation for the same semaphore, it wakes the first one up.
-   Returns -1 in arg4 field if error, else 0.
+/* Submits queued entries from the caller's submission ring and optionally waits for completions.
+   Entries that can finish at once, and Waits for children that have already quit, complete inline.
+   A SemP that would block is handed to the ring's workers, as is every later SemP on the same
+   semaphore until it completes, so that they still complete in order; other Waits complete
+   when a child quits.
+Input
+    arg1: number of entries to take from the submission ring.
+    arg2: block until at least this many completions are waiting in the completion ring.
+Output
+    arg1: number of entries submitted.
+    arg4: -1 if the caller has no ring; 0 otherwise.
 */
-void semv(USLOSS_Sysargs *args){
-    int semId = (uintptr_t)args->arg1; // Pull out semaphore ID from the args
-    int mbodId = SemTable[semId].mbox; // Get the mbox for this semaphore
-    MboxSend(mbodId, NULL, 0); // Acquire mutex
+void ringenter(USLOSS_Sysargs *args){
+    int toSubmit = (uintptr_t)args->arg1;
+    int minComplete = (uintptr_t)args->arg2;
+    p3ProcPtr me = getCurrentProc();
 
-    // Check for errors
-    if (semId < 0 || semId >= MAXSEMS || SemTable[semId].status == EMPTY) { 
+    if (me->ringId < 0 || RingTable[me->ringId].ownerPid != me->pid) { // Error check
+        args->arg1 = (void *)0;
         args->arg4 = (void *)-1;
+        enterUserMode();
         return;
     }
-    else {
-        args->arg4 = (void *)0;
+    ringPtr rng = &RingTable[me->ringId];
+    asyncRing * user = rng->user;
+
+    int submitted = 0;
+    while (submitted < toSubmit && user->sqHead != user->sqTail &&
+           rng->inflight + (int)(user->cqTail - user->cqHead) < RINGSIZE){
+        ringSqe sqe = user->sq[user->sqHead % RINGSIZE];
+        user->sqHead++;
+        submitted++;
+        MboxSend(ringTableMbox, NULL, 0); // Acquire mutex
+        rng->inflight++;
+        MboxReceive(ringTableMbox, NULL, 0); // Release mutex
+
+        if (sqe.args.number == SYS_WAIT){
+            rng->waitUserData[(rng->waitHead + rng->numWaits) % RINGSIZE] = sqe.userData;
+            rng->numWaits++;
+        }
+        else if (sqe.args.number == SYS_SEMP && ringDeferred(rng, (uintptr_t)sqe.args.arg1)){
+            ringDefer(rng, &sqe); // Queue behind the earlier SemP, it may not have blocked yet
+        }
+        else if (batchOne(&sqe.args) == 0){
+            ringPost(rng, &sqe);
+        }
+        else if (sqe.args.number == SYS_SEMP){
+            ringDefer(rng, &sqe);
+        }
+        else { // Not something a ring can run
+            sqe.args.arg4 = (void *)-1;
+            ringPost(rng, &sqe);
+        }
     }
 
-    if (SemTable[semId].blockedList == NULL) { // Simple case, no one is blocked on a "P" so simply increment sem's value
-        if (debugflag3){
-            USLOSS_Console("semv(): incrementing semaphore.\n");
-        }
-        SemTable[semId].value++;
-    } 
-    else { // Other proc(s) are blocked on "P" operation so wake the first up
-        if (debugflag3){
-            USLOSS_Console("semv(): waking up blocked proc.\n");
+    // Complete Waits for children that have quit, blocking until enough completions are posted
+    ringReapWaits(rng, me);
+    while ((int)(user->cqTail - user->cqHead) < minComplete && rng->inflight > 0){
+        MboxReceive(rng->eventMboxId, NULL, 0);
+        if (isDying()){
+            terminateReal(1);
         }
-        int wakeupId = SemTable[semId].blockedList->privateMboxId; // Get the ID of the process to wake up
-        SemTable[semId].blockedList = SemTable[semId].blockedList->nextBlocked; // Remove it from the queue of blocked processes
-        MboxSend(wakeupId, NULL, 0); // Wake up the blocked process
+        ringReapWaits(rng, me);
     }
-    
-    MboxReceive(mbodId, NULL, 0); // Release mutex
-    if (isZapped()){
+
+    args->arg1 = (void *)(long)submitted;
+    args->arg4 = (void *)0;
+
+    if (isDying()) {
         terminateReal(1);
     }
     enterUserMode();
 }
 
-/* Frees the semaphore, removing it from the semaphore table and terminating all of the processes blocked on it.
-   Semaphore to free is provided in arg1. arg4 will return -1 if error, 1 if freeing cause blocked processes to be killed,
-   and 0 otherwise.
+/*
+Body of every ring worker, runs in kernel mode. Takes SemP entries that would have
+blocked the ring's owner, blocks on them itself, and posts their completions.
 */
-void semfree(USLOSS_Sysargs *args){
-    int semId = (uintptr_t)args->arg1; // Pull out the semaphore ID
-    int mboxId = SemTable[semId].mbox; // Get the mailbox for this semaphore
-    MboxSend(mboxId, NULL, 0); // Acquire mutex
+int ringWorker(char * arg){
+    p3ProcPtr me = procAt(atoi(arg));
+    ringSqe sqe;
 
-    if (semId < 0 || semId >= MAXSEMS || SemTable[semId].status == EMPTY) { // Error check
-        args->arg4 = (void *)-1;
-        return;
-    }
-    else if (SemTable[semId].blockedList != NULL) { // Set return value to 1 if blocked processes will be terminated
-        args->arg4 = (void *)1;
+    //wait for ringsetup to finish creating pte
+    MboxReceive(me->spawnMboxId, NULL, 0);
+
+    while (1){
+        // The receive fails once the ring is destroyed
+        if (MboxReceive(RingTable[me->ringId].jobMboxId, &sqe, sizeof(ringSqe)) < 0 || isDying()){
+            terminateReal(1);
+        }
+        sqe.args.arg4 = (void *)(long)sempReal((uintptr_t)sqe.args.arg1, SEMP_WAITRETURN);
+        ringUndefer(&RingTable[me->ringId], (uintptr_t)sqe.args.arg1);
+        ringPost(&RingTable[me->ringId], &sqe);
     }
-    else {
-        args->arg4 = (void *)0;
+
+    return 0;
+}
+
+/*
+Writes the completion for sqe to the ring's completion ring and wakes the owner
+if it is waiting in ringenter
+*/
+void ringPost(ringPtr rng, ringSqe * sqe){
+    MboxSend(ringTableMbox, NULL, 0); // Acquire mutex
+    if (rng->status == OCCUPIED){
+        asyncRing * user = rng->user;
+        ringCqe * cqe = &user->cq[user->cqTail % RINGSIZE];
+        cqe->userData = sqe->userData;
+        cqe->args = sqe->args;
+        user->cqTail++;
+        rng->inflight--;
+        MboxCondSend(rng->eventMboxId, NULL, 0);
     }
+    MboxReceive(ringTableMbox, NULL, 0); // Release mutex
+}
 
-    // Terminate processes blocked on this semaphore if any
-    if (SemTable[semId].blockedList != NULL) {
-        if (debugflag3) {
-            USLOSS_Console("semfree(): terminating all procs blocked on this semaphore.\n");
+/*
+Hands a SemP entry to the ring's workers, noting its semaphore so that later
+SemPs on it are handed over too instead of completing inline ahead of it
+*/
+void ringDefer(ringPtr rng, ringSqe * sqe){
+    MboxSend(ringTableMbox, NULL, 0); // Acquire mutex
+    rng->deferred[rng->numDeferred++] = (uintptr_t)sqe->args.arg1;
+    MboxReceive(ringTableMbox, NULL, 0); // Release mutex
+    MboxSend(rng->jobMboxId, sqe, sizeof(ringSqe));
+}
+
+/*
+Returns 1 if a SemP on the given semaphore is with the ring's workers
+*/
+int ringDeferred(ringPtr rng, int handle){
+    int found = 0;
+    MboxSend(ringTableMbox, NULL, 0); // Acquire mutex
+    for (int i = 0; i < rng->numDeferred; i++){
+        if (rng->deferred[i] == handle){
+            found = 1;
+            break;
         }
-        SemTable[semId].zapped = 1; // Mark this semaphore as being freed so blocked procs know to terminate selves
-        p3ProcPtr curr = SemTable[semId].blockedList;
-        while (curr != NULL) { // Loop through the list waking up all of the blocked processes
-            p3ProcPtr temp = curr;
-            curr = curr->nextBlocked;
-            MboxSend(temp->privateMboxId, NULL, 0);
+    }
+    MboxReceive(ringTableMbox, NULL, 0); // Release mutex
+    return found;
+}
+
+/*
+Called by a worker once a SemP it was handed has completed
+*/
+void ringUndefer(ringPtr rng, int handle){
+    MboxSend(ringTableMbox, NULL, 0); // Acquire mutex
+    for (int i = 0; i < rng->numDeferred; i++){
+        if (rng->deferred[i] == handle){
+            rng->deferred[i] = rng->deferred[--rng->numDeferred];
+            break;
         }
     }
+    MboxReceive(ringTableMbox, NULL, 0); // Release mutex
+}
 
-    // Clear out the semaphore table entry
-    SemTable[semId].status = EMPTY;
-    SemTable[semId].blockedList = NULL;
-    numSems--; // Decrement number of active semaphores
+/*
+Completes pending Wait entries, one for each child of the owner that has already quit.
+Only the owner can join its children, so this runs in the owner's ringenter. The ring's
+workers are never waited for: once the owner has no other children, the remaining Waits
+complete with -1.
+*/
+void ringReapWaits(ringPtr rng, p3ProcPtr me){
+    while (rng->numWaits > 0){
+        int exited = 0;
+        for (exitRecordPtr rec = me->exitedKids; rec != NULL; rec = rec->next){
+            if (!rec->worker){
+                exited = 1;
+            }
+        }
+        if (!exited && waitableKids(me) > 0){ // Children left, but none has quit yet
+            return;
+        }
 
-    MboxReceive(mboxId, NULL, 0);
-    if (isZapped()){
-        terminateReal(1);
+        int status;
+        ringSqe sqe;
+        sqe.userData = rng->waitUserData[rng->waitHead];
+        rng->waitHead = (rng->waitHead + 1) % RINGSIZE;
+        rng->numWaits--;
+
+        sqe.args.number = SYS_WAIT;
+        if (exited){
+            sqe.args.arg1 = (void *)(long)waitReal(&status);
+            sqe.args.arg2 = (void *)(long)status;
+            sqe.args.arg4 = (void *)0;
+        }
+        else { // Nothing left to wait for
+            sqe.args.arg4 = (void *)-1;
+        }
+        ringPost(rng, &sqe);
     }
-    enterUserMode();
+}
+
+/*
+Destroys the ring owned by proc, if any. Releasing its job queue wakes the idle
+workers, which then terminate themselves; busy ones are torn down with proc's subtree.
+*/
+void destroyRing(p3ProcPtr proc){
+    if (proc->ringId < 0){
+        return;
+    }
+    MboxSend(ringTableMbox, NULL, 0); // Acquire mutex
+    ringPtr rng = &RingTable[proc->ringId];
+    if (rng->status == OCCUPIED && rng->ownerPid == proc->pid){
+        rng->status = EMPTY;
+        rng->ownerPid = -1;
+        rng->user = NULL;
+        MboxRelease(rng->jobMboxId);
+        MboxRelease(rng->eventMboxId);
+        rng->jobMboxId = -1;
+        rng->eventMboxId = -1;
+    }
+    proc->ringId = -1;
+    MboxReceive(ringTableMbox, NULL, 0); // Release mutex
 }
 
 /*
@@ -750,6 +3422,12 @@ int isInKernelMode() {
 Enters user mode by calling psrget()
 */
 int enterUserMode() {
+    if (SYSCALL_STATS){
+        p3ProcPtr me = getCurrentProc();
+        if (me != NULL && me->curSyscall != NULL){
+            syscallDone(me);
+        }
+    }
     unsigned int psr = USLOSS_PsrGet();
     unsigned int op = 0xfffffffe;
     int result = USLOSS_PsrSet(psr & op);
@@ -762,11 +3440,9 @@ int enterUserMode() {
 }
 
 /*
-Set all fields to the process and append to parent's list
+Set all fields to the process, make it findable by pid and append to parent's list
 */
-void initProc(int pid, int parentPid){
-
-    p3ProcPtr proc = getProc(pid);
+void initProc(p3ProcPtr proc, int pid, int parentPid){
 
     //set fields
     proc->status = OCCUPIED;
@@ -776,10 +3452,42 @@ void initProc(int pid, int parentPid){
     proc->nextBlocked = NULL;
     proc->func = NULL;
     proc->parentPid = parentPid;
+    proc->dying = 0;
+    proc->blockedSem = -1;
+    proc->pgid = -1;
+    proc->nextInGroup = NULL;
+    proc->killed = 0;
+    proc->detached = 0;
+    proc->worker = 0;
+    proc->poolTicket = -1;
+    proc->numKids = 0;
+    proc->argBuf = NULL;
+    proc->notifySem = -1;
+    proc->ringId = -1;
+    proc->exitedKids = NULL;
+    proc->vdsoCpu = 0;
+    proc->curSyscall = NULL;
+    memset(&proc->sw, 0, sizeof(switchStats));
+    proc->switchedInAt = readClock();
+    proc->priority = 0;
+    proc->wokenAt = -1;
+    proc->stackTop = NULL;
+    proc->stackLow = NULL;
+    proc->stackHigh = NULL;
+    proc->timerLevel = -1;
+    proc->nextTimer = NULL;
+    proc->prevTimer = NULL;
+    memset(&proc->usage, 0, sizeof(procUsage));
+    proc->usage.spawnTime = readClock();
+    proc->usage.stackHighWater = -1;
+
+    //add to the hash chain for its pid
+    proc->nextHash = ProcHash[pid % PROCHASHSIZE];
+    ProcHash[pid % PROCHASHSIZE] = proc;
 
     //append to parent's children
-    if (parentPid > 0){
-        p3ProcPtr parentProc = getProc(parentPid);
+    p3ProcPtr parentProc = getProc(parentPid);
+    if (parentProc != NULL){
         if (parentProc->children == NULL){
             parentProc->children = proc;
         } else {
@@ -792,6 +3500,11 @@ void initProc(int pid, int parentPid){
             prev->nextChild = proc;
         }
         parentProc->numKids++;
+
+        //children start out in their parent's process group
+        if (parentProc->pgid >= 0){
+            joinGroup(proc, parentProc->pgid);
+        }
     }
 }
 
@@ -799,8 +3512,47 @@ p3ProcPtr getCurrentProc(){
     return getProc(getpid());
 }
 
+/*
+Returns the PTE of pid by walking its hash chain, NULL if pid has none
+*/
 p3ProcPtr getProc(int pid) {
-    return &ProcTable[pid % MAXPROC];
+    if (pid < 0){
+        return NULL;
+    }
+    for (p3ProcPtr proc = ProcHash[pid % PROCHASHSIZE]; proc != NULL; proc = proc->nextHash){
+        if (proc->pid == pid){
+            return proc;
+        }
+    }
+    return NULL;
+}
+
+/*
+Returns the PTE of pid, or NULL if pid is not a live phase3 proc. Phase1 never reuses a
+pid, so a pid is already a slot plus generation handle; a stale pid simply isn't in
+ProcHash any more. Use this instead of getProc for any pid that came from a user.
+*/
+p3ProcPtr lookupProc(int pid) {
+    p3ProcPtr proc = getProc(pid);
+    if (proc == NULL || proc->status == EMPTY){
+        return NULL;
+    }
+    return proc;
+}
+
+/*
+Returns the semaphore named by handle, or NULL if it is out of range, free, or
+from an earlier generation of its slot.
+*/
+semPtr lookupSem(int handle) {
+    if (handle < 0){
+        return NULL;
+    }
+    semPtr semaphore = &SemTable[handle % MAXSEMS];
+    if (semaphore->status == EMPTY || semaphore->handle != handle){
+        return NULL;
+    }
+    return semaphore;
 }
 
 /*
@@ -812,12 +3564,13 @@ void dumpProcesses3() {
     statuses[EMPTY] = "EMPTY";
 
 
-    USLOSS_Console(" SLOT   PID   PARENTPID     STATUS     NUM CHILDREN \n");
-    USLOSS_Console("------ ----- ----------- ------------ --------------\n");
-    for (int i = 0; i < MAXPROC; i++){
-            p3ProcPtr temp = &ProcTable[i];
+    USLOSS_Console(" SLOT   PID   PARENTPID     STATUS     NUM CHILDREN  SWITCHES    VOL  INVOL  ONCPU_US LONGEST_US\n");
+    USLOSS_Console("------ ----- ----------- ------------ -------------- --------- ------ ------ --------- ----------\n");
+    for (int i = 0; i < numProcSlabs * PROCSLAB; i++){
+            p3ProcPtr temp = procAt(i);
             int parentpid = temp->parentPid; 
-            USLOSS_Console("%6d %5d %11d %12s %14d\n", i, temp->pid, parentpid, statuses[temp->status], temp->numKids);
+            USLOSS_Console("%6d %5d %11d %12s %14d %9d %6d %6d %9d %10d\n", i, temp->pid, parentpid, statuses[temp->status], temp->numKids,
+                           temp->usage.switches, temp->sw.voluntary, temp->sw.involuntary, temp->sw.onCpu, temp->sw.longest);
     }
 }
 
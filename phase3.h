@@ -7,7 +7,251 @@
 
 #define MAXSEMS         200
 
-#endif /* _PHASE3_H */
+/*
+ * Worker-process pools
+ */
+#define MAXPOOLS        10
+#define MAXPOOLWORKERS  10
+#define MAXPOOLJOBS     100
 
+/*
+ * Process groups
+ */
+#define MAXGROUPS       MAXPROC
 
+/*
+ * Phase 3 syscalls beyond those defined in usyscall.h
+ */
+#define SYS_POOLCREATE  30
+#define SYS_POOLSUBMIT  31
+#define SYS_POOLWAIT    32
+#define SYS_POOLNEXT    33
+#define SYS_SETPGID     34
+#define SYS_KILLGROUP   35
+#define SYS_WAITGROUP   36
+#define SYS_SPAWNDETACHED 37
+#define SYS_WAITEX      38
+#define SYS_SPAWNARGS   39
+#define SYS_SPAWNNOTIFY 40
+#define SYS_SYSCALLBATCH 41
+#define SYS_RINGSETUP   42
+#define SYS_RINGENTER   43
+#define SYS_GETSTATS    44
+#define SYS_TRACEDRAIN  45
+#define SYS_PROFCONTROL 46
+#define SYS_PROFDUMP    47
+#define SYS_SNAPSHOT    48
 
+/*
+ * Resource usage of a process, returned by WaitEx. The child fields
+ * total everything used by descendants the process has waited for.
+ * Times are in the units of CPUTime and GetTimeofDay.
+ */
+typedef struct procUsage {
+    int cpuTime;        // CPU time used by the process itself
+    int childCpuTime;
+    int spawnTime;      // time of day the process was spawned
+    int exitTime;       // time of day the process terminated
+    int syscalls;       // syscalls made by the process itself
+    int childSyscalls;
+    int switches;       // times the process was switched onto the CPU
+    int childSwitches;
+    int stackSize;      // bytes of stack the process was spawned with
+    int stackHighWater; // most bytes of it ever in use, -1 if not measured
+    int childStackHighWater; // largest stackHighWater among reaped descendants
+} procUsage;
+
+/*
+ * Arguments to the Spawn variants that take more than fit in USLOSS_Sysargs
+ */
+typedef struct spawnRequest {
+    char *name;
+    int (*func)(char *);
+    char *arg;
+    long len;           // size of arg, for SpawnArgs
+    long stack_size;
+    long priority;
+    long notifySem;     // semaphore V'd when the child terminates, for SpawnNotify
+} spawnRequest;
+
+/*
+ * Submission/completion rings for asynchronous syscalls. The user fills
+ * sq[sqTail % RINGSIZE] and advances sqTail, the kernel advances sqHead
+ * as it takes entries. The kernel fills cq[cqTail % RINGSIZE] and
+ * advances cqTail, the user advances cqHead as it consumes them. Entries
+ * are syscalls laid out as for USLOSS_Syscall; completions carry their
+ * outputs. Spawn, Wait, SemP, SemV and the others SyscallBatch accepts
+ * may be submitted.
+ */
+#define RINGSIZE        32
+
+typedef struct ringSqe {
+    USLOSS_Sysargs args;
+    long userData;      // copied to the completion
+} ringSqe;
+
+typedef struct ringCqe {
+    USLOSS_Sysargs args;
+    long userData;
+} ringCqe;
+
+typedef struct asyncRing {
+    ringSqe sq[RINGSIZE];
+    unsigned int sqHead;
+    unsigned int sqTail;
+    ringCqe cq[RINGSIZE];
+    unsigned int cqHead;
+    unsigned int cqTail;
+} asyncRing;
+
+/*
+ * Kernel statistics, fetched with GetStats by kind
+ */
+#define STATS_SYSCALLS  0       // syscallStats[MAXSYSCALLS], indexed by number
+#define STATS_SWITCHES  1       // switchStats of each live proc, then pid -1 if room
+#define STATS_WAKEUPS   2       // wakeupStats across all semaphores, handle -1
+#define STATS_SEMWAKEUPS 3      // wakeupStats of each live semaphore, then handle -1 if room
+#define STATS_STACKS    4       // stackStats of each live proc, then pid -1 if room
+
+#define STATBUCKETS     16      // bucket i counts latencies in [2^i - 1, 2^(i+1) - 1) us
+
+typedef struct syscallStats {
+    int calls;
+    int errors;         // calls that reported failure through arg4
+    int latency[STATBUCKETS];
+} syscallStats;
+
+/*
+ * A switch is involuntary when the clock interrupt takes the CPU away
+ * (time slicing), voluntary when the proc gives it up by blocking or
+ * quitting. Times are in us.
+ */
+typedef struct switchStats {
+    int pid;
+    int switchIns;
+    int voluntary;
+    int involuntary;
+    int onCpu;          // total time holding the CPU
+    int longest;        // longest single interval holding the CPU
+    int intervals[STATBUCKETS]; // histogram of those intervals
+} switchStats;
+
+/*
+ * Wakeup latency is the time from a SemV taking a waiter off a semaphore
+ * to that waiter's SemP returning to user mode, in us. It is kept by the
+ * waiter's priority, latency[0] being priority 1 (the highest).
+ */
+#define WAKEPRIOS       5
+
+/*
+ * Stack use of a live process, in bytes. Stacks are only painted when a
+ * process is spawned by libphase3debug.a, so highWater is -1 in the
+ * default build and for procs not made by a Spawn.
+ */
+typedef struct stackStats {
+    int pid;
+    int stackSize;
+    int highWater;
+} stackStats;
+
+typedef struct wakeupStats {
+    int handle;
+    int latency[WAKEPRIOS][STATBUCKETS];
+} wakeupStats;
+
+/*
+ * Kernel event trace. The kernel records events into a ring of TRACESIZE
+ * entries, overwriting the oldest when it is full; TraceDrain copies them
+ * out oldest first. Entries are written to files as-is for tracedump.
+ * If P3_CHROME_TRACE names a file, every event since start2 is also
+ * written there as Chrome Trace Event JSON when start2 returns.
+ */
+#define TRACESIZE       1024
+
+#define TRACE_FORK      1       // pid forked by arg1
+#define TRACE_SWITCH    2       // pid switched in, replacing arg1
+#define TRACE_QUIT      3       // pid quit
+#define TRACE_SPAWN     4       // pid spawned by arg1
+#define TRACE_TERMINATE 5       // pid terminated with status arg1
+#define TRACE_SEMBLOCK  6       // pid blocked on semaphore arg1
+#define TRACE_SEMWAKE   7       // pid woken from semaphore arg1 by arg2
+#define TRACE_POINT     8       // tracepoint at phase3.c line arg1 hit, first value arg2
+
+typedef struct traceEvent {
+    int time;           // time of day, us
+    int pid;
+    int type;           // one of the TRACE_ constants
+    int arg1;
+    int arg2;
+} traceEvent;
+
+/*
+ * Sampling profiler. While it runs, every clock interrupt counts a sample
+ * against the interrupted pid and where it was: in user code, in the
+ * kernel serving a syscall (by number), or elsewhere in the kernel.
+ * Syscalls are only told apart when built with SYSCALL_STATS.
+ */
+#define PROF_USER       MAXSYSCALLS     // samples in user code
+#define PROF_KERNEL     (MAXSYSCALLS+1) // samples in the kernel outside a syscall
+#define PROFLOCS        (MAXSYSCALLS+2) // 0..MAXSYSCALLS-1 are syscall numbers
+
+typedef struct profEntry {
+    int pid;
+    int samples[PROFLOCS];
+} profEntry;
+
+/*
+ * System snapshot, as written by GetSystemSnapshot: a snapHeader, then
+ * numProcs snapProcs, then numSems snapSems, all taken at one instant.
+ */
+#define SNAP_RUNNING    0       // the proc that took the snapshot
+#define SNAP_ACTIVE     1       // ready, or blocked outside a semaphore
+#define SNAP_SEMBLOCKED 2       // blocked in SemP on blockedOn
+#define SNAP_DYING      3       // zapped or killed, terminating
+
+typedef struct snapHeader {
+    int time;           // time of day the snapshot was taken
+    int numProcs;
+    int numSems;
+} snapHeader;
+
+typedef struct snapProc {
+    int pid;
+    int parentPid;
+    short state;        // one of the SNAP_ constants
+    short priority;
+    int blockedOn;      // semaphore handle if SNAP_SEMBLOCKED, else -1
+    int cpu;            // us spent on the CPU
+} snapProc;
+
+typedef struct snapSem {
+    int handle;
+    int value;
+    int waiters;        // procs blocked in SemP on it
+    int owner;          // pid of the proc that created it
+} snapSem;
+
+/*
+ * Data the kernel keeps current for the running process, so that user
+ * code can read it without a syscall. pid and argLen are exact. tod and cpu are
+ * refreshed on every context switch and clock tick, so they lag the
+ * values GetTimeofDay and CPUTime return by up to one tick.
+ */
+typedef struct vdsoPage {
+    int pid;
+    int tod;            // time of day at the last refresh
+    int cpu;            // CPU time of pid at the last refresh
+    int ticks;          // clock interrupts seen since start2
+    long argLen;        // size of the buffer SpawnArgs gave pid, -1 if none
+} vdsoPage;
+
+extern const volatile vdsoPage * const vdso;
+
+/*
+ * Hooks called from p1.c
+ */
+extern void p3_fork(int pid);
+extern void p3_switch(int old, int new);
+extern void p3_quit(int pid);
+
+#endif /* _PHASE3_H */
@@ -1,5 +1,70 @@
 #!/bin/bash
 
+# Usage: runtests.sh        diff each test's output against testResults/
+#        runtests.sh -b     time each test and benchmark against perfBaselines/
+#        runtests.sh -u     as -b, but store the new numbers as the baselines
+#
+# -b and -u run each program RUNS times (default 5) with P3_PERF set and
+# take the median of the CPU time and syscall count it prints. A program
+# regresses if either exceeds its baseline by more than THRESHOLD percent
+# (default 10). Programs without a baseline get one.
+
+if [ "$1" == "-b" ] || [ "$1" == "-u" ]; then
+   baselinedir="perfBaselines/"
+   fext=".txt"
+   runs=${RUNS:-5}
+   threshold=${THRESHOLD:-10}
+   regressions=0
+
+   mkdir $baselinedir &> /dev/null
+
+   for i in testcases/*.c benchmarks/*.c
+   do
+      prog="$(basename $i .c)"
+      echo -n "Timing $prog ....................... "
+
+      make $prog &> /dev/null
+      cpus=()
+      calls=()
+      for run in $(seq $runs)
+      do
+         perf="$(P3_PERF=1 ./$prog 2>&1 | grep '^PERF ')"
+         if [ -n "$perf" ]; then
+            cpus+=($(sed -n 's/.*cpu_us=\([0-9]*\).*/\1/p' <<< "$perf"))
+            calls+=($(sed -n 's/.*syscalls=\([0-9]*\).*/\1/p' <<< "$perf"))
+         fi
+      done
+
+      if [ ${#cpus[@]} -eq 0 ]; then
+         echo "NO DATA"
+         continue
+      fi
+      mid=$(( (${#cpus[@]} + 1) / 2 ))
+      cpu=$(printf "%s\n" "${cpus[@]}" | sort -n | sed -n "${mid}p")
+      syscalls=$(printf "%s\n" "${calls[@]}" | sort -n | sed -n "${mid}p")
+
+      baseline=$baselinedir$prog$fext
+      if [ "$1" == "-u" ] || [ ! -f $baseline ]; then
+         echo "cpu_us=$cpu syscalls=$syscalls" > $baseline
+         echo "BASELINE cpu_us=$cpu syscalls=$syscalls"
+         continue
+      fi
+
+      basecpu=$(sed -n 's/.*cpu_us=\([0-9]*\).*/\1/p' $baseline)
+      basecalls=$(sed -n 's/.*syscalls=\([0-9]*\).*/\1/p' $baseline)
+      if [ $(( cpu * 100 )) -gt $(( basecpu * (100 + threshold) )) ] ||
+         [ $(( syscalls * 100 )) -gt $(( basecalls * (100 + threshold) )) ]; then
+         echo "REGRESSED cpu_us=$cpu ($basecpu) syscalls=$syscalls ($basecalls)"
+         regressions=$(expr $regressions + 1)
+      else
+         echo "OK cpu_us=$cpu ($basecpu) syscalls=$syscalls ($basecalls)"
+      fi
+   done
+
+   make clean &> /dev/null
+   exit $(( regressions > 0 ))
+fi
+
 array=($(ls testcases/*.c))
 fname="results"
 resultsdir="testResults/"
@@ -1,15 +1,112 @@
 
 #define EMPTY 0
 #define OCCUPIED 1
+#define JOB_RUNNING 2     //pool job taken by a worker
+#define JOB_DONE 3        //pool job finished, its result is valid
+
+#define PROCSLAB 16         //PTEs allocated at a time as the proc table grows
+#define PROCHASHSIZE MAXPROC //chains in the pid to PTE hash
+
+/* Tracepoints. TP_LEVEL picks the most detailed level compiled in and
+   TP_CATS which categories; everything else compiles to nothing. Enabled
+   tracepoints are recorded in the trace ring as TRACE_POINT events, with
+   their line in phase3.c and first argument, or printed with
+   USLOSS_Console instead if TP_CONSOLE is defined.
+*/
+#ifndef TP_LEVEL
+#define TP_LEVEL 0
+#endif
+#ifndef TP_CATS
+#define TP_CATS TPC_ALL
+#endif
+
+#define TP_ERROR 1
+#define TP_INFO 2
+#define TP_DEBUG 3
+
+#define TPC_PROC 0x01      //spawn, wait and terminate
+#define TPC_SEM 0x02
+#define TPC_POOL 0x04
+#define TPC_GROUP 0x08
+#define TPC_SYSCALL 0x10   //everything else
+#define TPC_ALL 0xff
+
+#define TP_FIRST(zero, first, ...) (first)
+#ifdef TP_CONSOLE
+#define TP_EMIT(fmt, ...) USLOSS_Console(fmt, ##__VA_ARGS__)
+#else
+#define TP_EMIT(fmt, ...) traceRecord(TRACE_POINT, getpid(), __LINE__, (int)(long)TP_FIRST(0, ##__VA_ARGS__, 0))
+#endif
+#define TP(cat, level, fmt, ...) do { \
+        if (TP_LEVEL >= (level) && (TP_CATS & (cat))) { \
+            TP_EMIT(fmt, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#ifndef STACK_WATERMARK
+#define STACK_WATERMARK 0  //build with -DSTACK_WATERMARK=1 to paint spawned stacks and measure their use
+#endif
+
+#define STACKCANARY 0x5a5aa5a5 //painted over unused stack, to find how deep it was used
+#define STACKGAP 256       //bytes left unpainted below paintStack's frame
+#define STACKSLOP 4096     //bytes phase1 may use above spawnLaunch's frame, never painted
+
+#define MAXGENERATION 1000000  //semaphore handles are slot + MAXSEMS * generation
+
+#define SEMP_NOWAIT 0      //sempReal returns 1 instead of blocking
+#define SEMP_WAIT 1        //sempReal blocks, terminating the caller if the semaphore is freed
+#define SEMP_WAITRETURN 2  //sempReal blocks, returning -1 if the semaphore is freed
+
+#ifndef SYSCALL_STATS
+#define SYSCALL_STATS 1    //build with -DSYSCALL_STATS=0 to leave syscall dispatch uninstrumented
+#endif
+
+#define TIMELINESIZE 65536 //events kept for the Chrome trace written at shutdown
+#define TIMELINEENV "P3_CHROME_TRACE" //names the file to write it to, no trace if unset
+#define PERFENV "P3_PERF"  //if set, start2 prints a PERF line of totals for runtests.sh -b
+
+#define PROFSLOTS 128      //pids the profiler keeps samples for, later pids are dropped
+
+#define MAXRINGS 10
+#define RINGWORKERS 4      //kernel procs completing each ring's blocking entries
+
+#define FORK_DETACHED 1   //forkProc flags: reaped by start2 instead of the parent
+#define FORK_WORKER 2     //a pool worker, which Wait never returns
+
+#define REAP_SPAWN 0
+#define REAP_EXIT 1
+#define REAP_DAEMON 2      //start the clock daemon, forked by start2 so that it outlives the requester
+
+#define WHEELBITS 6
+#define WHEELSIZE (1 << WHEELBITS) //slots per level of the timer wheel
+#define WHEELMASK (WHEELSIZE - 1)
+#define WHEELLEVELS 3      //level n slots are WHEELSIZE^n ticks wide
+#define TICK_US (USLOSS_CLOCK_MS * 1000) //length of a timer wheel tick
 
 typedef struct p3Proc* p3ProcPtr;
 typedef struct sem* semPtr;
+typedef struct pool* poolPtr;
+typedef struct poolJob* poolJobPtr;
+typedef struct group* groupPtr;
+typedef struct detachReq* detachReqPtr;
+typedef struct exitRecord* exitRecordPtr;
+typedef struct argBuf* argBufPtr;
+typedef struct ring* ringPtr;
 
 
 typedef struct p3Proc p3Proc;
 typedef struct sem sem;
+typedef struct pool pool;
+typedef struct poolJob poolJob;
+typedef struct group group;
+typedef struct detachReq detachReq;
+typedef struct reaperMsg reaperMsg;
+typedef struct exitRecord exitRecord;
+typedef struct argBuf argBuf;
+typedef struct ring ring;
 
 struct p3Proc {
+    int index;      //position of the PTE in the proc table, fixed for its lifetime
     int pid;        //pid of phase3 proc
     int status;     //status of proc
     int privateMboxId;
@@ -21,6 +118,37 @@ struct p3Proc {
     p3ProcPtr nextChild;
     p3ProcPtr nextBlocked;
     int numKids;
+    int dying;      //set when an ancestor is tearing down its subtree
+    int blockedSem; //semaphore the proc is blocked on, -1 if none
+    int pgid;       //process group of the proc, -1 if none
+    p3ProcPtr nextInGroup;
+    int killed;     //set by KillGroup, proc terminates with killStatus
+    int killStatus;
+    int detached;   //reaped by start2 instead of the proc that spawned it
+    int worker;     //pool or ring worker, skipped by Wait
+    int poolTicket; //pool job the proc is running as a worker, -1 if none
+    p3ProcPtr nextHash; //next PTE in the same ProcHash chain
+    p3ProcPtr nextFree; //next PTE on the free list
+    procUsage usage;    //resources used by the proc and its reaped descendants
+    exitRecordPtr exitedKids; //usage of children that have quit but not been joined
+    argBufPtr argBuf;   //buffer passed by SpawnArgs instead of arg, NULL if none
+    int notifySem;      //semaphore to V on termination, -1 if none
+    int ringId;         //ring the proc owns or works for, -1 if none
+    int vdsoCpu;        //CPU time as of the last clock tick it was running for
+    USLOSS_Sysargs * curSyscall; //syscall being timed for the stats, NULL if none
+    int syscallStart;   //time of day the syscall was dispatched
+    switchStats sw;     //how the proc has been switched in and out, pid and switchIns unused
+    int switchedInAt;   //time of day the proc last got the CPU
+    int priority;       //priority it was forked with
+    int wokenAt;        //time of day a V took it off a semaphore, -1 if not since its last P
+    char * stackTop;          //a local in spawnLaunch's frame, NULL if not spawned
+    unsigned int * stackLow;  //lowest word painted with STACKCANARY, NULL if not painted
+    unsigned int * stackHigh; //just above the highest painted word
+    int wakeTick;       //timer wheel tick a Sleep ends at
+    int timerLevel;     //timer wheel level it is on, -1 if not sleeping
+    int timerSlot;
+    p3ProcPtr nextTimer; //other sleepers in the same slot
+    p3ProcPtr prevTimer;
 };
 
 struct sem {
@@ -29,7 +157,78 @@ struct sem {
     p3ProcPtr blockedList;
     int mbox;
     int zapped;
+    int generation; //times this slot has been freed
+    int handle;     //id given to users, -1 while the slot is free
+    int wakeups[WAKEPRIOS][STATBUCKETS]; //wakeup latency of its waiters, by priority
+    int creatorPid;
+};
+
+struct pool {
+    int status;     //status of pool
+    int ownerPid;   //pid of the proc that created the pool
+    int numWorkers;
+    int jobMboxId;  //queue of job tickets waiting for a worker
+};
+
+struct poolJob {
+    int status;     //status of job slot
+    int poolId;     //pool the job was submitted to
+    int (*func)(char *);
+    char * arg;
+    int result;     //return value of func, valid once doneMboxId is sent to
+    int doneMboxId; //1 slot mailbox, sent to when a worker finishes the job
+    int waiting;    //set while a PoolWait is blocked on the job
+};
+
+struct group {
+    int pgid;       //id of the group
+    int status;     //status of group
+    p3ProcPtr members;
+    int numMembers;
+    int waitMboxId; //receives one message per WaitGroup caller when the group empties
+    int numWaiters;
 };
 
+struct detachReq {
+    char * name;
+    int (*func)(char *);
+    char * arg;
+    int stack_size;
+    int priority;
+    int pid;        //filled in by start2, -1 if the fork failed
+};
+
+struct reaperMsg {
+    int type;       //REAP_SPAWN, REAP_EXIT or REAP_DAEMON
+    int pid;        //pid of the requesting or terminating proc
+    detachReqPtr req;
+};
 
+struct exitRecord {
+    int pid;        //pid of the child that quit
+    int worker;     //the child was a pool or ring worker, Wait skips it
+    procUsage usage;
+    exitRecordPtr next;
+};
 
+struct argBuf {
+    void * data;    //buffer owned by the kernel since SpawnArgs, freed with refs
+    long len;
+    int refs;       //procs still running with data as their argument
+    argBufPtr next;
+};
+
+struct ring {
+    int status;     //status of ring
+    int ownerPid;   //pid of the proc that set up the ring
+    asyncRing * user; //the rings themselves, in the owner's memory
+    int inflight;   //entries submitted but not yet completed
+    int numWorkers; //workers forked for the ring, children of the owner that Wait skips
+    long waitUserData[RINGSIZE]; //pending Wait entries, completed in order
+    int waitHead;
+    int numWaits;
+    int jobMboxId;  //SemP entries waiting for a worker
+    int deferred[RINGSIZE]; //semaphores of SemP entries handed to workers and not yet completed
+    int numDeferred;
+    int eventMboxId; //sent to when a completion is posted or a child quits
+};
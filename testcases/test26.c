@@ -0,0 +1,77 @@
+/* Pool test: a job runs on the pool's worker, and jobs still queued when
+ * the pool's owner terminates complete with -1.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+#include <stdio.h>
+
+int Owner(char *);
+int Job(char *);
+
+int ticketB, ticketC;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int start3(char *arg)
+{
+    int pid, status, result, rc;
+
+    USLOSS_Console("start3(): started\n");
+    Spawn("Owner", Owner, NULL, USLOSS_MIN_STACK, 2, &pid);
+    Wait(&pid, &status);
+    USLOSS_Console("start3(): child %d returned status %d\n", pid, status);
+
+    rc = PoolWait(ticketB, &result);
+    USLOSS_Console("start3(): PoolWait for job B returned %d, result %d\n", rc, result);
+    rc = PoolWait(ticketC, &result);
+    USLOSS_Console("start3(): PoolWait for job C returned %d, result %d\n", rc, result);
+    rc = PoolWait(ticketB, &result);
+    USLOSS_Console("start3(): PoolWait for job B again returned %d\n", rc);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(8);
+
+    return 0;
+} /* start3 */
+
+
+int Owner(char *arg)
+{
+    int pool, ticket, result, rc;
+
+    USLOSS_Console("Owner(): started\n");
+
+    /* the worker is below us, so jobs only run while we are blocked */
+    rc = PoolCreate(1, USLOSS_MIN_STACK, 4, &pool);
+    USLOSS_Console("Owner(): PoolCreate returned %d\n", rc);
+
+    PoolSubmit(pool, Job, "A", &ticket);
+    PoolWait(ticket, &result);
+    USLOSS_Console("Owner(): job A returned %d\n", result);
+
+    PoolSubmit(pool, Job, "B", &ticketB);
+    PoolSubmit(pool, Job, "C", &ticketC);
+    USLOSS_Console("Owner(): terminating with jobs B and C queued\n");
+    Terminate(3);
+
+    return 0;
+} /* Owner */
+
+
+int Job(char *arg)
+{
+    USLOSS_Console("Job(): running job %s\n", arg);
+
+    return 10;
+} /* Job */
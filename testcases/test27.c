@@ -0,0 +1,107 @@
+/* Process group test: KillGroup terminates members blocked in SemP with
+ * the status it is given, WaitGroup returns once they are gone, and a
+ * process outside the group blocked on the same semaphore is untouched.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+#include <stdio.h>
+
+int Member(char *);
+int Bystander(char *);
+int Killer(char *);
+
+int semaphore;
+int group;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int start3(char *arg)
+{
+    int pid1, pid2, pid3, pid, status, rc1, rc2;
+
+    USLOSS_Console("start3(): started\n");
+    SemCreate(0, &semaphore);
+
+    /* all three are below us, so none runs until we block */
+    Spawn("Member1", Member, "Member1", USLOSS_MIN_STACK, 4, &pid1);
+    Spawn("Member2", Member, "Member2", USLOSS_MIN_STACK, 4, &pid2);
+    Spawn("Bystander", Bystander, NULL, USLOSS_MIN_STACK, 4, &pid3);
+    USLOSS_Console("start3(): spawned Member1 %d, Member2 %d and Bystander %d\n",
+                   pid1, pid2, pid3);
+
+    group = pid1;
+    rc1 = SetPgid(pid1, 0);
+    rc2 = SetPgid(pid2, group);
+    USLOSS_Console("start3(): SetPgid returned %d and %d\n", rc1, rc2);
+
+    /* the killer is lowest, it runs once everyone else is blocked */
+    Spawn("Killer", Killer, NULL, USLOSS_MIN_STACK, 5, &pid);
+    USLOSS_Console("start3(): spawned Killer %d, calling WaitGroup\n", pid);
+    rc1 = WaitGroup(group);
+    USLOSS_Console("start3(): WaitGroup returned %d\n", rc1);
+
+    Wait(&pid, &status);
+    USLOSS_Console("start3(): child %d returned status %d\n", pid, status);
+    Wait(&pid, &status);
+    USLOSS_Console("start3(): child %d returned status %d\n", pid, status);
+
+    USLOSS_Console("start3(): calling SemV\n");
+    SemV(semaphore);
+    Wait(&pid, &status);
+    USLOSS_Console("start3(): child %d returned status %d\n", pid, status);
+    Wait(&pid, &status);
+    USLOSS_Console("start3(): child %d returned status %d\n", pid, status);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(8);
+
+    return 0;
+} /* start3 */
+
+
+int Member(char *arg)
+{
+    USLOSS_Console("%s(): blocking on SemP\n", arg);
+    SemP(semaphore);
+    USLOSS_Console("%s(): SemP returned, test failed\n", arg);
+    Terminate(1);
+
+    return 0;
+} /* Member */
+
+
+int Bystander(char *arg)
+{
+    int rc;
+
+    USLOSS_Console("Bystander(): blocking on SemP\n");
+    rc = SemP(semaphore);
+    USLOSS_Console("Bystander(): SemP returned %d\n", rc);
+    Terminate(7);
+
+    return 0;
+} /* Bystander */
+
+
+int Killer(char *arg)
+{
+    int rc;
+
+    USLOSS_Console("Killer(): calling KillGroup\n");
+    rc = KillGroup(group, 42);
+    USLOSS_Console("Killer(): KillGroup returned %d\n", rc);
+    Terminate(8);
+
+    return 0;
+} /* Killer */
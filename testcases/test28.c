@@ -0,0 +1,85 @@
+/* Detached process test: a process started with SpawnDetached outlives
+ * the process that launched it, and the launcher's Wait only ever returns
+ * its ordinary children.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+#include <stdio.h>
+
+int Launcher(char *);
+int Orphan(char *);
+int Child(char *);
+
+int semaphore;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int start3(char *arg)
+{
+    int pid, status;
+
+    USLOSS_Console("start3(): started\n");
+    SemCreate(0, &semaphore);
+
+    Spawn("Launcher", Launcher, NULL, USLOSS_MIN_STACK, 2, &pid);
+    Wait(&pid, &status);
+    USLOSS_Console("start3(): child %d returned status %d\n", pid, status);
+
+    USLOSS_Console("start3(): calling SemV for the detached process\n");
+    SemV(semaphore);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(8);
+
+    return 0;
+} /* start3 */
+
+
+int Launcher(char *arg)
+{
+    int pid, status, rc;
+
+    USLOSS_Console("Launcher(): started\n");
+    rc = SpawnDetached("Orphan", Orphan, NULL, USLOSS_MIN_STACK, 2, &pid);
+    USLOSS_Console("Launcher(): SpawnDetached returned %d, pid %d\n", rc, pid);
+
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK, 4, &pid);
+    USLOSS_Console("Launcher(): spawned Child %d, calling Wait\n", pid);
+    Wait(&pid, &status);
+    USLOSS_Console("Launcher(): Wait returned child %d with status %d\n", pid, status);
+
+    USLOSS_Console("Launcher(): terminating\n");
+    Terminate(5);
+
+    return 0;
+} /* Launcher */
+
+
+int Orphan(char *arg)
+{
+    SemP(semaphore);
+    USLOSS_Console("Orphan(): woken after its launcher quit\n");
+    Terminate(6);
+
+    return 0;
+} /* Orphan */
+
+
+int Child(char *arg)
+{
+    USLOSS_Console("Child(): started\n");
+    Terminate(11);
+
+    return 0;
+} /* Child */
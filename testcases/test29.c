@@ -0,0 +1,114 @@
+/* Ring test: a SemP that would block is handed to a ring worker, a Wait
+ * completes when the child quits, a GetPID completes inline, and a Wait
+ * with no children left completes with -1.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+#include <stdio.h>
+
+int Child(char *);
+void submit(int number, long arg1, long userData);
+void reap(void);
+
+int semaphore;
+asyncRing ring;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int start3(char *arg)
+{
+    int pid, rc;
+
+    USLOSS_Console("start3(): started\n");
+    SemCreate(0, &semaphore);
+
+    rc = RingSetup(&ring);
+    USLOSS_Console("start3(): RingSetup returned %d\n", rc);
+
+    /* the child is below us, so it only runs once RingEnter blocks */
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK, 4, &pid);
+    USLOSS_Console("start3(): spawned Child %d\n", pid);
+
+    USLOSS_Console("start3(): submitting SemP, Wait and GetPID\n");
+    submit(SYS_SEMP, semaphore, 1);
+    submit(SYS_WAIT, 0, 2);
+    submit(SYS_GETPID, 0, 3);
+    rc = RingEnter(3, 3);
+    USLOSS_Console("start3(): RingEnter submitted %d\n", rc);
+    reap();
+
+    submit(SYS_WAIT, 0, 4);
+    rc = RingEnter(1, 1);
+    USLOSS_Console("start3(): RingEnter submitted %d\n", rc);
+    reap();
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(8);
+
+    return 0;
+} /* start3 */
+
+
+int Child(char *arg)
+{
+    int rc;
+
+    USLOSS_Console("Child(): started, calling SemV\n");
+    rc = SemV(semaphore);
+    USLOSS_Console("Child(): SemV returned %d\n", rc);
+    Terminate(12);
+
+    return 0;
+} /* Child */
+
+
+void submit(int number, long arg1, long userData)
+{
+    ringSqe *sqe = &ring.sq[ring.sqTail % RINGSIZE];
+
+    sqe->args.number = number;
+    sqe->args.arg1 = (void *) arg1;
+    sqe->userData = userData;
+    ring.sqTail++;
+} /* submit */
+
+
+void reap(void)
+{
+    while (ring.cqHead != ring.cqTail) {
+        ringCqe *cqe = &ring.cq[ring.cqHead % RINGSIZE];
+
+        switch (cqe->args.number) {
+            case SYS_SEMP:
+                USLOSS_Console("start3(): completion %ld: SemP returned %ld\n",
+                               cqe->userData, (long) cqe->args.arg4);
+                break;
+            case SYS_WAIT:
+                if ((long) cqe->args.arg4 < 0) {
+                    USLOSS_Console("start3(): completion %ld: Wait returned -1\n",
+                                   cqe->userData);
+                }
+                else {
+                    USLOSS_Console("start3(): completion %ld: Wait returned child %ld with status %ld\n",
+                                   cqe->userData, (long) cqe->args.arg1, (long) cqe->args.arg2);
+                }
+                break;
+            case SYS_GETPID:
+                USLOSS_Console("start3(): completion %ld: GetPID returned %ld\n",
+                               cqe->userData, (long) cqe->args.arg1);
+                break;
+        }
+        ring.cqHead++;
+    }
+} /* reap */
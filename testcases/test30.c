@@ -0,0 +1,100 @@
+/* Sleep test: sleepers on the first two levels of the timer wheel wake in
+ * order and no earlier than asked, and a sleeper on the top level is taken
+ * off the wheel and terminated when its parent terminates.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+#include <stdio.h>
+
+int Short(char *);
+int Medium(char *);
+int Long(char *);
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int start3(char *arg)
+{
+    int pid, status;
+
+    USLOSS_Console("start3(): started\n");
+
+    /* each sleeper runs until it blocks in Sleep before Spawn returns */
+    Spawn("Short", Short, NULL, USLOSS_MIN_STACK, 2, &pid);
+    Spawn("Medium", Medium, NULL, USLOSS_MIN_STACK, 2, &pid);
+    Spawn("Long", Long, NULL, USLOSS_MIN_STACK, 2, &pid);
+
+    Wait(&pid, &status);
+    USLOSS_Console("start3(): child %d returned status %d\n", pid, status);
+    Wait(&pid, &status);
+    USLOSS_Console("start3(): child %d returned status %d\n", pid, status);
+
+    USLOSS_Console("start3(): terminating while Long is still asleep\n");
+    Terminate(8);
+
+    return 0;
+} /* start3 */
+
+
+/* a few ticks, level 0 */
+int Short(char *arg)
+{
+    int before, after;
+
+    USLOSS_Console("Short(): sleeping 50000us\n");
+    GetTimeofDay(&before);
+    SleepUs(50000);
+    GetTimeofDay(&after);
+    if (after - before >= 50000) {
+        USLOSS_Console("Short(): woke up after at least 50000us\n");
+    }
+    else {
+        USLOSS_Console("Short(): woke up after only %dus\n", after - before);
+    }
+    Terminate(11);
+
+    return 0;
+} /* Short */
+
+
+/* about a hundred ticks, level 1 until it cascades down */
+int Medium(char *arg)
+{
+    int before, after;
+
+    USLOSS_Console("Medium(): sleeping 2 seconds\n");
+    GetTimeofDay(&before);
+    Sleep(2);
+    GetTimeofDay(&after);
+    if (after - before >= 2000000) {
+        USLOSS_Console("Medium(): woke up after at least 2 seconds\n");
+    }
+    else {
+        USLOSS_Console("Medium(): woke up after only %dus\n", after - before);
+    }
+    Terminate(12);
+
+    return 0;
+} /* Medium */
+
+
+/* thousands of ticks, level 2, never expires */
+int Long(char *arg)
+{
+    USLOSS_Console("Long(): sleeping 100 seconds\n");
+    Sleep(100);
+    USLOSS_Console("Long(): woke up, test failed\n");
+    Terminate(13);
+
+    return 0;
+} /* Long */
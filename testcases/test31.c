@@ -0,0 +1,107 @@
+/* Pool worker test: Wait never returns a pool's workers, a job may only
+ * be waited for once, and a process that is not one of the pool's workers
+ * cannot take its jobs.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+#include <stdio.h>
+
+int Owner(char *);
+int Waiter(char *);
+int Child(char *);
+int Job(char *);
+
+int pool, ticket;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int start3(char *arg)
+{
+    int pid, status;
+
+    USLOSS_Console("start3(): started\n");
+    Spawn("Owner", Owner, NULL, USLOSS_MIN_STACK, 2, &pid);
+    Wait(&pid, &status);
+    USLOSS_Console("start3(): child %d returned status %d\n", pid, status);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(8);
+
+    return 0;
+} /* start3 */
+
+
+int Owner(char *arg)
+{
+    int pid, status, result, rc;
+
+    /* the worker is below us, so the job only runs once we block */
+    rc = PoolCreate(1, USLOSS_MIN_STACK, 4, &pool);
+    USLOSS_Console("Owner(): PoolCreate returned %d\n", rc);
+    PoolSubmit(pool, Job, "A", &ticket);
+
+    /* the waiter is above us, it blocks in PoolWait before Spawn returns */
+    Spawn("Waiter", Waiter, NULL, USLOSS_MIN_STACK, 1, &pid);
+    USLOSS_Console("Owner(): spawned Waiter %d\n", pid);
+    rc = PoolWait(ticket, &result);
+    USLOSS_Console("Owner(): second PoolWait for job A returned %d\n", rc);
+
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK, 4, &pid);
+    USLOSS_Console("Owner(): spawned Child %d, calling Wait\n", pid);
+    Wait(&pid, &status);
+    USLOSS_Console("Owner(): child %d returned status %d\n", pid, status);
+    Wait(&pid, &status);
+    USLOSS_Console("Owner(): child %d returned status %d\n", pid, status);
+
+    USLOSS_Console("Owner(): terminating with its worker idle\n");
+    Terminate(3);
+
+    return 0;
+} /* Owner */
+
+
+int Waiter(char *arg)
+{
+    int result, rc;
+
+    USLOSS_Console("Waiter(): calling PoolWait for job A\n");
+    rc = PoolWait(ticket, &result);
+    USLOSS_Console("Waiter(): PoolWait returned %d, result %d\n", rc, result);
+    Terminate(7);
+
+    return 0;
+} /* Waiter */
+
+
+int Child(char *arg)
+{
+    USLOSS_Sysargs sysArg;
+
+    sysArg.number = SYS_POOLNEXT;
+    sysArg.arg1 = (void *) (long) pool;
+    sysArg.arg3 = (void *) 0;
+    USLOSS_Syscall(&sysArg);
+    USLOSS_Console("Child(): taking a job from the pool returned %ld\n", (long) sysArg.arg4);
+    Terminate(11);
+
+    return 0;
+} /* Child */
+
+
+int Job(char *arg)
+{
+    USLOSS_Console("Job(): running job %s\n", arg);
+
+    return 10;
+} /* Job */
@@ -0,0 +1,108 @@
+/* Cascading termination test: when a process terminates, children and
+ * grandchildren blocked on a semaphore are woken and torn down with it,
+ * and none of them is left on the semaphore's blocked list.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+#include <stdio.h>
+
+int Parent(char *);
+int Middle(char *);
+int Leaf(char *);
+int Taker(char *);
+
+int semaphore;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int start3(char *arg)
+{
+    int pid, status;
+
+    USLOSS_Console("start3(): started\n");
+    SemCreate(0, &semaphore);
+
+    Spawn("Parent", Parent, NULL, USLOSS_MIN_STACK, 2, &pid);
+    Wait(&pid, &status);
+    USLOSS_Console("start3(): child %d returned status %d\n", pid, status);
+
+    /* with no stale waiters left the V is kept for the taker */
+    USLOSS_Console("start3(): calling SemV\n");
+    SemV(semaphore);
+    Spawn("Taker", Taker, NULL, USLOSS_MIN_STACK, 2, &pid);
+    Wait(&pid, &status);
+    USLOSS_Console("start3(): child %d returned status %d\n", pid, status);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(8);
+
+    return 0;
+} /* start3 */
+
+
+int Parent(char *arg)
+{
+    int pid;
+
+    /* each middle is above us, it and its leaf block before Spawn returns */
+    Spawn("Middle1", Middle, "1", USLOSS_MIN_STACK, 1, &pid);
+    USLOSS_Console("Parent(): spawned Middle1 %d\n", pid);
+    Spawn("Middle2", Middle, "2", USLOSS_MIN_STACK, 1, &pid);
+    USLOSS_Console("Parent(): spawned Middle2 %d\n", pid);
+
+    USLOSS_Console("Parent(): terminating with its subtree blocked\n");
+    Terminate(2);
+
+    return 0;
+} /* Parent */
+
+
+int Middle(char *arg)
+{
+    char name[16];
+    int pid;
+
+    snprintf(name, sizeof(name), "Leaf%s", arg);
+    USLOSS_Console("Middle%s(): spawning %s\n", arg, name);
+    Spawn(name, Leaf, arg, USLOSS_MIN_STACK, 1, &pid);
+    USLOSS_Console("Middle%s(): blocking on SemP\n", arg);
+    SemP(semaphore);
+    USLOSS_Console("Middle%s(): SemP returned, test failed\n", arg);
+    Terminate(1);
+
+    return 0;
+} /* Middle */
+
+
+int Leaf(char *arg)
+{
+    USLOSS_Console("Leaf%s(): blocking on SemP\n", arg);
+    SemP(semaphore);
+    USLOSS_Console("Leaf%s(): SemP returned, test failed\n", arg);
+    Terminate(1);
+
+    return 0;
+} /* Leaf */
+
+
+int Taker(char *arg)
+{
+    int rc;
+
+    rc = SemP(semaphore);
+    USLOSS_Console("Taker(): SemP returned %d\n", rc);
+    Terminate(9);
+
+    return 0;
+} /* Taker */
@@ -0,0 +1,63 @@
+/* WaitEx test: WaitEx returns the child's pid, status and resource usage,
+ * and both WaitEx and Wait return -1 once the caller has no children left.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+#include <stdio.h>
+
+int Child(char *);
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int start3(char *arg)
+{
+    int pid, status, rc;
+    procUsage usage;
+
+    USLOSS_Console("start3(): started\n");
+
+    /* the child is above us, it has terminated before Spawn returns */
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK, 2, &pid);
+    rc = WaitEx(&pid, &status, &usage);
+    USLOSS_Console("start3(): WaitEx returned %d, child %d, status %d\n", rc, pid, status);
+    USLOSS_Console("start3(): child made %d syscalls, stack size %s\n", usage.syscalls,
+                   usage.stackSize == USLOSS_MIN_STACK ? "as spawned" : "wrong");
+    USLOSS_Console("start3(): child exited %s it was spawned\n",
+                   usage.exitTime >= usage.spawnTime ? "after" : "before");
+
+    rc = WaitEx(&pid, &status, &usage);
+    USLOSS_Console("start3(): WaitEx with no children returned %d\n", rc);
+    rc = Wait(&pid, &status);
+    USLOSS_Console("start3(): Wait with no children returned %d\n", rc);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(8);
+
+    return 0;
+} /* start3 */
+
+
+/* three syscalls, then Terminate makes four */
+int Child(char *arg)
+{
+    int semaphore;
+
+    SemCreate(0, &semaphore);
+    SemCreate(0, &semaphore);
+    SemCreate(0, &semaphore);
+    USLOSS_Console("Child(): made three syscalls\n");
+    Terminate(11);
+
+    return 0;
+} /* Child */
@@ -0,0 +1,79 @@
+/* SpawnArgs test: a child started with SpawnArgs is handed the caller's
+ * buffer itself along with its length, and a child started with Spawn
+ * has no buffer length.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BUFLEN 4096
+
+int Reader(char *);
+int Plain(char *);
+
+char *buffer;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int start3(char *arg)
+{
+    int pid, status, rc;
+
+    USLOSS_Console("start3(): started\n");
+    buffer = malloc(BUFLEN);
+    memset(buffer, 'x', BUFLEN - 1);
+    buffer[BUFLEN - 1] = '\0';
+
+    /* both children are above us, they have terminated before the spawn returns */
+    rc = SpawnArgs("Reader", Reader, buffer, BUFLEN, USLOSS_MIN_STACK, 2, &pid);
+    USLOSS_Console("start3(): SpawnArgs returned %d, pid %d\n", rc, pid);
+    Wait(&pid, &status);
+    USLOSS_Console("start3(): child %d returned status %d\n", pid, status);
+
+    Spawn("Plain", Plain, "short", USLOSS_MIN_STACK, 2, &pid);
+    Wait(&pid, &status);
+    USLOSS_Console("start3(): child %d returned status %d\n", pid, status);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(8);
+
+    return 0;
+} /* start3 */
+
+
+int Reader(char *arg)
+{
+    long len;
+
+    GetArgLen(&len);
+    USLOSS_Console("Reader(): given %s buffer of length %ld holding %d characters\n",
+                   arg == buffer ? "the caller's" : "a copy of the", len, (int) strlen(arg));
+    Terminate(11);
+
+    return 0;
+} /* Reader */
+
+
+int Plain(char *arg)
+{
+    long len;
+
+    GetArgLen(&len);
+    USLOSS_Console("Plain(): given \"%s\", buffer length %ld\n", arg, len);
+    Terminate(12);
+
+    return 0;
+} /* Plain */
@@ -0,0 +1,98 @@
+/* Ring ordering test: once a SemP has been handed to a ring worker, a
+ * later SemP on the same semaphore waits its turn behind it even if the
+ * semaphore was V'd in between, and Wait never returns a ring worker.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+#include <stdio.h>
+
+int Owner(char *);
+void submit(int number, long arg1, long userData);
+void reap(void);
+
+int semaphore;
+asyncRing ring;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int start3(char *arg)
+{
+    int pid, status;
+
+    USLOSS_Console("start3(): started\n");
+    Spawn("Owner", Owner, NULL, USLOSS_MIN_STACK, 1, &pid);
+    Wait(&pid, &status);
+    USLOSS_Console("start3(): child %d returned status %d\n", pid, status);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(8);
+
+    return 0;
+} /* start3 */
+
+
+/* above the ring's workers, so they only run once RingEnter blocks */
+int Owner(char *arg)
+{
+    int pid, status, rc;
+
+    SemCreate(0, &semaphore);
+    rc = RingSetup(&ring);
+    USLOSS_Console("Owner(): RingSetup returned %d\n", rc);
+
+    USLOSS_Console("Owner(): submitting SemP, SemV and SemP on one semaphore\n");
+    submit(SYS_SEMP, semaphore, 1);
+    submit(SYS_SEMV, semaphore, 2);
+    submit(SYS_SEMP, semaphore, 3);
+    rc = RingEnter(3, 2);
+    USLOSS_Console("Owner(): RingEnter submitted %d\n", rc);
+    reap();
+
+    USLOSS_Console("Owner(): submitting SemV\n");
+    submit(SYS_SEMV, semaphore, 4);
+    rc = RingEnter(1, 2);
+    USLOSS_Console("Owner(): RingEnter submitted %d\n", rc);
+    reap();
+
+    rc = Wait(&pid, &status);
+    USLOSS_Console("Owner(): Wait with only ring workers left returned %d\n", rc);
+
+    USLOSS_Console("Owner(): terminating\n");
+    Terminate(5);
+
+    return 0;
+} /* Owner */
+
+
+void submit(int number, long arg1, long userData)
+{
+    ringSqe *sqe = &ring.sq[ring.sqTail % RINGSIZE];
+
+    sqe->args.number = number;
+    sqe->args.arg1 = (void *) arg1;
+    sqe->userData = userData;
+    ring.sqTail++;
+} /* submit */
+
+
+void reap(void)
+{
+    while (ring.cqHead != ring.cqTail) {
+        ringCqe *cqe = &ring.cq[ring.cqHead % RINGSIZE];
+
+        USLOSS_Console("Owner(): completion %ld: %s returned %ld\n", cqe->userData,
+                       cqe->args.number == SYS_SEMP ? "SemP" : "SemV", (long) cqe->args.arg4);
+        ring.cqHead++;
+    }
+} /* reap */
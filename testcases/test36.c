@@ -0,0 +1,73 @@
+/* Syscall statistics test: GetSyscallStats counts every call of a syscall,
+ * counts the ones that fail as errors, and puts each one in a latency
+ * bucket. GetStats rejects a kind it does not know.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+#include <stdio.h>
+
+int timed(syscallStats *stats);
+
+syscallStats before[MAXSYSCALLS];
+syscallStats after[MAXSYSCALLS];
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int start3(char *arg)
+{
+    int sem1, sem2, rc, number;
+
+    USLOSS_Console("start3(): started\n");
+    rc = GetSyscallStats(before);
+    USLOSS_Console("start3(): GetSyscallStats returned %d\n", rc);
+
+    SemCreate(1, &sem1);
+    SemCreate(0, &sem2);
+    rc = SemP(-1);
+    USLOSS_Console("start3(): SemP on a bad handle returned %d\n", rc);
+    rc = SemP(sem1);
+    USLOSS_Console("start3(): SemP returned %d\n", rc);
+
+    GetSyscallStats(after);
+    number = SYS_SEMCREATE;
+    USLOSS_Console("start3(): SemCreate: %d calls, %d errors, %d timed\n",
+                   after[number].calls - before[number].calls,
+                   after[number].errors - before[number].errors,
+                   timed(&after[number]) - timed(&before[number]));
+    number = SYS_SEMP;
+    USLOSS_Console("start3(): SemP: %d calls, %d errors, %d timed\n",
+                   after[number].calls - before[number].calls,
+                   after[number].errors - before[number].errors,
+                   timed(&after[number]) - timed(&before[number]));
+
+    rc = GetStats(99, after, sizeof(after));
+    USLOSS_Console("start3(): GetStats of an unknown kind returned %d\n", rc);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(8);
+
+    return 0;
+} /* start3 */
+
+
+/* number of calls in the latency histogram */
+int timed(syscallStats *stats)
+{
+    int i, sum = 0;
+
+    for (i = 0; i < STATBUCKETS; i++) {
+        sum += stats->latency[i];
+    }
+    return sum;
+} /* timed */
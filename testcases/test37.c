@@ -0,0 +1,93 @@
+/* Trace test: TraceDrain returns the fork, spawn, semaphore block and
+ * wakeup, terminate and quit events of a child in the order they happened,
+ * and loses none of them.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+#include <stdio.h>
+
+int Child(char *);
+
+int semaphore;
+traceEvent events[TRACESIZE];
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int start3(char *arg)
+{
+    int pid, status, count, lost, i;
+    traceEvent *ev;
+
+    USLOSS_Console("start3(): started\n");
+    SemCreate(0, &semaphore);
+
+    /* empty the ring of everything recorded while booting */
+    while (TraceDrain(events, TRACESIZE, &lost) > 0) {
+    }
+
+    /* the child is above us, it runs until it blocks in SemP */
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK, 2, &pid);
+    USLOSS_Console("start3(): spawned Child %d, calling SemV\n", pid);
+    SemV(semaphore);
+    Wait(&pid, &status);
+    USLOSS_Console("start3(): child %d returned status %d\n", pid, status);
+
+    count = TraceDrain(events, TRACESIZE, &lost);
+    USLOSS_Console("start3(): TraceDrain lost %d events\n", lost);
+    for (i = 0; i < count; i++) {
+        ev = &events[i];
+        if (ev->pid != pid) {
+            continue;
+        }
+        switch (ev->type) {
+            case TRACE_FORK:
+                USLOSS_Console("start3(): %d forked by %d\n", ev->pid, ev->arg1);
+                break;
+            case TRACE_SPAWN:
+                USLOSS_Console("start3(): %d spawned by %d\n", ev->pid, ev->arg1);
+                break;
+            case TRACE_SEMBLOCK:
+                USLOSS_Console("start3(): %d blocked on %s\n", ev->pid,
+                               ev->arg1 == semaphore ? "the semaphore" : "another semaphore");
+                break;
+            case TRACE_SEMWAKE:
+                USLOSS_Console("start3(): %d woken from %s by %d\n", ev->pid,
+                               ev->arg1 == semaphore ? "the semaphore" : "another semaphore",
+                               ev->arg2);
+                break;
+            case TRACE_TERMINATE:
+                USLOSS_Console("start3(): %d terminated with status %d\n", ev->pid, ev->arg1);
+                break;
+            case TRACE_QUIT:
+                USLOSS_Console("start3(): %d quit\n", ev->pid);
+                break;
+        }
+    }
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(8);
+
+    return 0;
+} /* start3 */
+
+
+int Child(char *arg)
+{
+    USLOSS_Console("Child(): blocking on SemP\n");
+    SemP(semaphore);
+    USLOSS_Console("Child(): SemP returned\n");
+    Terminate(3);
+
+    return 0;
+} /* Child */
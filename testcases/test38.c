@@ -0,0 +1,94 @@
+/* Chrome trace test: with P3_CHROME_TRACE set, a JSON trace is written at
+ * shutdown with run slices, a semaphore block slice, and the child's spawn
+ * and terminate. test_cleanup only prints if the file is missing or wrong.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACEFILE "test38.json"
+
+int Child(char *);
+
+int semaphore;
+
+char *expected[] = {
+    "{\"traceEvents\":[",
+    "\"name\":\"run\",\"ph\":\"B\"",
+    "\"name\":\"spawn\"",
+    "\"cat\":\"block\",\"ph\":\"b\"",
+    "\"cat\":\"block\",\"ph\":\"e\"",
+    "\"name\":\"terminate\",\"ph\":\"i\",\"s\":\"t\",\"pid\":0,\"tid\":5",
+    "\"args\":{\"status\":3}",
+    "\"displayTimeUnit\":\"ms\"}",
+};
+
+void test_setup(int argc, char *argv[])
+{
+    setenv("P3_CHROME_TRACE", TRACEFILE, 1);
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+    FILE *in;
+    char *text;
+    long size;
+    int i;
+
+    in = fopen(TRACEFILE, "r");
+    if (in == NULL) {
+        printf("test_cleanup(): %s was not written\n", TRACEFILE);
+        return;
+    }
+    fseek(in, 0, SEEK_END);
+    size = ftell(in);
+    rewind(in);
+    text = calloc(size + 1, 1);
+    size = fread(text, 1, size, in);
+    fclose(in);
+
+    for (i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        if (strstr(text, expected[i]) == NULL) {
+            printf("test_cleanup(): %s has no %s\n", TRACEFILE, expected[i]);
+        }
+    }
+    free(text);
+    remove(TRACEFILE);
+}
+
+
+int start3(char *arg)
+{
+    int pid, status;
+
+    USLOSS_Console("start3(): started\n");
+    SemCreate(0, &semaphore);
+
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK, 2, &pid);
+    USLOSS_Console("start3(): spawned Child %d, calling SemV\n", pid);
+    SemV(semaphore);
+    Wait(&pid, &status);
+    USLOSS_Console("start3(): child %d returned status %d\n", pid, status);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(8);
+
+    return 0;
+} /* start3 */
+
+
+int Child(char *arg)
+{
+    USLOSS_Console("Child(): blocking on SemP\n");
+    SemP(semaphore);
+    USLOSS_Console("Child(): SemP returned\n");
+    Terminate(3);
+
+    return 0;
+} /* Child */
@@ -0,0 +1,86 @@
+/* Switch statistics test: a child that blocks in SemP three times gives up
+ * the CPU voluntarily at least three times and is never preempted, and
+ * GetSwitchStats ends its list with a pid of -1.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+#include <stdio.h>
+
+int Child(char *);
+
+int semaphore;
+switchStats stats[MAXPROC + 1];
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int start3(char *arg)
+{
+    int pid, status, i;
+
+    USLOSS_Console("start3(): started\n");
+    SemCreate(0, &semaphore);
+
+    /* the child is above us, so it runs each time it is woken */
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK, 2, &pid);
+    for (i = 0; i < 3; i++) {
+        USLOSS_Console("start3(): calling SemV\n");
+        SemV(semaphore);
+    }
+    Wait(&pid, &status);
+    USLOSS_Console("start3(): child %d returned status %d\n", pid, status);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(8);
+
+    return 0;
+} /* start3 */
+
+
+int Child(char *arg)
+{
+    int i, me, rc, found = 0, ended = 0;
+
+    GetPID(&me);
+    for (i = 0; i < 3; i++) {
+        USLOSS_Console("Child(): blocking on SemP\n");
+        SemP(semaphore);
+    }
+
+    rc = GetSwitchStats(stats, MAXPROC + 1);
+    USLOSS_Console("Child(): GetSwitchStats returned %d\n", rc);
+    for (i = 0; i < MAXPROC + 1; i++) {
+        if (stats[i].pid == -1) {
+            ended = 1;
+            break;
+        }
+        if (stats[i].pid != me) {
+            continue;
+        }
+        found = 1;
+        if (stats[i].voluntary >= 3) {
+            USLOSS_Console("Child(): at least 3 voluntary switches\n");
+        }
+        else {
+            USLOSS_Console("Child(): only %d voluntary switches\n", stats[i].voluntary);
+        }
+        USLOSS_Console("Child(): %d involuntary switches\n", stats[i].involuntary);
+        if (stats[i].switchIns > stats[i].voluntary + stats[i].involuntary) {
+            USLOSS_Console("Child(): switched in once more than out\n");
+        }
+    }
+    USLOSS_Console("Child(): found own entry %d, list ended %d\n", found, ended);
+    Terminate(3);
+
+    return 0;
+} /* Child */
@@ -0,0 +1,64 @@
+/* Profiler test: samples taken while start3 spins in user code are counted
+ * against start3 as user samples, none are dropped, and starting a running
+ * profiler or stopping a stopped one fails.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+#include <stdio.h>
+
+profEntry profile[MAXPROC];
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int start3(char *arg)
+{
+    int me, start, rc, count, dropped, i;
+
+    USLOSS_Console("start3(): started\n");
+    GetPID(&me);
+
+    rc = ProfStart();
+    USLOSS_Console("start3(): ProfStart returned %d\n", rc);
+    rc = ProfStart();
+    USLOSS_Console("start3(): ProfStart again returned %d\n", rc);
+
+    /* spin for about 200ms without a syscall, about ten clock ticks */
+    start = vdso->tod;
+    while (vdso->tod - start < 200000) {
+    }
+
+    rc = ProfStop();
+    USLOSS_Console("start3(): ProfStop returned %d\n", rc);
+    rc = ProfStop();
+    USLOSS_Console("start3(): ProfStop again returned %d\n", rc);
+
+    count = ProfDump(profile, MAXPROC, &dropped);
+    USLOSS_Console("start3(): ProfDump dropped %d samples\n", dropped);
+    for (i = 0; i < count; i++) {
+        if (profile[i].pid != me) {
+            continue;
+        }
+        if (profile[i].samples[PROF_USER] > 0) {
+            USLOSS_Console("start3(): own user samples counted\n");
+        }
+        else {
+            USLOSS_Console("start3(): no user samples, test failed\n");
+        }
+    }
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(8);
+
+    return 0;
+} /* start3 */
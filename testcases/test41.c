@@ -0,0 +1,96 @@
+/* Wakeup statistics test: three SemVs to a priority 2 waiter add three
+ * wakeups to the priority 2 row, both across all semaphores and for the
+ * semaphore it waited on, and none to a semaphore nobody waited on.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+#include <stdio.h>
+
+int Child(char *);
+int wakeups(wakeupStats *stats, int prio);
+
+int semaphore, idle;
+wakeupStats before, after;
+wakeupStats perSem[MAXSEMS + 1];
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int start3(char *arg)
+{
+    int pid, status, rc, i, prio;
+
+    USLOSS_Console("start3(): started\n");
+    SemCreate(0, &semaphore);
+    SemCreate(0, &idle);
+    GetWakeupStats(&before);
+
+    /* the child is above us, so it runs each time it is woken */
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK, 2, &pid);
+    for (i = 0; i < 3; i++) {
+        SemV(semaphore);
+    }
+    Wait(&pid, &status);
+    USLOSS_Console("start3(): child %d returned status %d\n", pid, status);
+
+    rc = GetWakeupStats(&after);
+    USLOSS_Console("start3(): GetWakeupStats returned %d, handle %d\n", rc, after.handle);
+    for (prio = 1; prio <= WAKEPRIOS; prio++) {
+        USLOSS_Console("start3(): priority %d: %d wakeups\n", prio,
+                       wakeups(&after, prio) - wakeups(&before, prio));
+    }
+
+    rc = GetSemWakeupStats(perSem, MAXSEMS + 1);
+    USLOSS_Console("start3(): GetSemWakeupStats returned %d\n", rc);
+    for (i = 0; i < MAXSEMS + 1 && perSem[i].handle != -1; i++) {
+        if (perSem[i].handle == semaphore) {
+            USLOSS_Console("start3(): semaphore: %d wakeups at priority 2, %d at priority 1\n",
+                           wakeups(&perSem[i], 2), wakeups(&perSem[i], 1));
+        }
+        else if (perSem[i].handle == idle) {
+            USLOSS_Console("start3(): idle semaphore: %d wakeups at priority 2\n",
+                           wakeups(&perSem[i], 2));
+        }
+    }
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(8);
+
+    return 0;
+} /* start3 */
+
+
+int Child(char *arg)
+{
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        SemP(semaphore);
+        USLOSS_Console("Child(): woken\n");
+    }
+    Terminate(3);
+
+    return 0;
+} /* Child */
+
+
+/* wakeups counted at prio, over every latency bucket */
+int wakeups(wakeupStats *stats, int prio)
+{
+    int i, sum = 0;
+
+    for (i = 0; i < STATBUCKETS; i++) {
+        sum += stats->latency[prio - 1][i];
+    }
+    return sum;
+} /* wakeups */
@@ -0,0 +1,69 @@
+/* Tracepoint test: the default library is built with TP_LEVEL 0, so
+ * spawning, waiting, semaphore operations and a failed Spawn leave only
+ * ordinary events in the trace ring and no TRACE_POINT events.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+#include <stdio.h>
+
+int Child(char *);
+
+traceEvent events[TRACESIZE];
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int start3(char *arg)
+{
+    int pid, status, sem, rc, count, lost, i, points = 0, others = 0;
+
+    USLOSS_Console("start3(): started\n");
+    while (TraceDrain(events, TRACESIZE, &lost) > 0) {
+    }
+
+    SemCreate(1, &sem);
+    SemP(sem);
+    SemV(sem);
+    SemFree(sem);
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK, 2, &pid);
+    Wait(&pid, &status);
+    USLOSS_Console("start3(): child %d returned status %d\n", pid, status);
+    rc = Spawn("Child", Child, NULL, USLOSS_MIN_STACK, 9, &pid);
+    USLOSS_Console("start3(): Spawn at priority 9 returned %d\n", rc);
+
+    count = TraceDrain(events, TRACESIZE, &lost);
+    for (i = 0; i < count; i++) {
+        if (events[i].type == TRACE_POINT) {
+            points++;
+        }
+        else {
+            others++;
+        }
+    }
+    USLOSS_Console("start3(): %d tracepoint events, other events recorded %d\n",
+                   points, others > 0);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(8);
+
+    return 0;
+} /* start3 */
+
+
+int Child(char *arg)
+{
+    USLOSS_Console("Child(): started\n");
+    Terminate(3);
+
+    return 0;
+} /* Child */
@@ -0,0 +1,86 @@
+/* Snapshot test: GetSystemSnapshot reports the size it needs when the
+ * buffer is too small, and then shows the caller running, a child blocked
+ * on a semaphore, and that semaphore with one waiter.
+ */
+
+#include <usloss.h>
+#include <usyscall.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+#include <stdio.h>
+
+int Child(char *);
+
+int semaphore;
+char buf[8192];
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+
+int start3(char *arg)
+{
+    int pid, status, rc, size, needed, i;
+    snapHeader *head = (snapHeader *) buf;
+    snapProc *procs;
+    snapSem *sems;
+
+    USLOSS_Console("start3(): started\n");
+    SemCreate(0, &semaphore);
+
+    /* the child is above us, it runs until it blocks in SemP */
+    Spawn("Child", Child, NULL, USLOSS_MIN_STACK, 2, &pid);
+
+    rc = GetSystemSnapshot(buf, 0, &needed);
+    USLOSS_Console("start3(): GetSystemSnapshot with no room returned %d\n", rc);
+    rc = GetSystemSnapshot(buf, sizeof(buf), &size);
+    USLOSS_Console("start3(): GetSystemSnapshot returned %d, size matches %d\n",
+                   rc, size == needed);
+
+    procs = (snapProc *) (buf + sizeof(snapHeader));
+    sems = (snapSem *) (procs + head->numProcs);
+    for (i = 0; i < head->numProcs; i++) {
+        if (procs[i].pid == 4) {
+            USLOSS_Console("start3(): pid 4 state %d\n", procs[i].state);
+        }
+        else if (procs[i].pid == pid) {
+            USLOSS_Console("start3(): pid %d state %d, parent %d, priority %d, %s\n",
+                           procs[i].pid, procs[i].state, procs[i].parentPid,
+                           procs[i].priority,
+                           procs[i].blockedOn == semaphore ? "blocked on the semaphore"
+                                                           : "not blocked on the semaphore");
+        }
+    }
+    for (i = 0; i < head->numSems; i++) {
+        if (sems[i].handle == semaphore) {
+            USLOSS_Console("start3(): semaphore value %d, waiters %d, owner %d\n",
+                           sems[i].value, sems[i].waiters, sems[i].owner);
+        }
+    }
+
+    SemV(semaphore);
+    Wait(&pid, &status);
+    USLOSS_Console("start3(): child %d returned status %d\n", pid, status);
+
+    USLOSS_Console("start3(): done\n");
+    Terminate(8);
+
+    return 0;
+} /* start3 */
+
+
+int Child(char *arg)
+{
+    USLOSS_Console("Child(): blocking on SemP\n");
+    SemP(semaphore);
+    USLOSS_Console("Child(): SemP returned\n");
+    Terminate(3);
+
+    return 0;
+} /* Child */
@@ -0,0 +1,55 @@
+/*
+ * Prints kernel trace files as text. A trace file is the traceEvents
+ * returned by TraceDrain, written out as-is with fwrite, e.g.
+ *
+ *     while ((n = TraceDrain(events, TRACESIZE, &lost)) > 0)
+ *         fwrite(events, sizeof(traceEvent), n, file);
+ *
+ * Usage: tracedump [file]   (reads stdin if no file is given)
+ */
+
+#include <usloss.h>
+#include <phase1.h>
+#include <phase3.h>
+#include <stdio.h>
+
+static char *eventNames[] = {
+    [TRACE_FORK]      = "fork",
+    [TRACE_SWITCH]    = "switch",
+    [TRACE_QUIT]      = "quit",
+    [TRACE_SPAWN]     = "spawn",
+    [TRACE_TERMINATE] = "terminate",
+    [TRACE_SEMBLOCK]  = "semblock",
+    [TRACE_SEMWAKE]   = "semwake",
+    [TRACE_POINT]     = "point",
+};
+
+int main(int argc, char *argv[])
+{
+    FILE *in = stdin;
+    traceEvent ev;
+    int n = sizeof(eventNames) / sizeof(eventNames[0]);
+
+    if (argc > 2) {
+        fprintf(stderr, "usage: %s [file]\n", argv[0]);
+        return 2;
+    }
+    if (argc == 2 && (in = fopen(argv[1], "rb")) == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    printf("%10s %5s %-10s %8s %8s\n", "TIME", "PID", "EVENT", "ARG1", "ARG2");
+    while (fread(&ev, sizeof(ev), 1, in) == 1) {
+        if (ev.type > 0 && ev.type < n && eventNames[ev.type] != NULL)
+            printf("%10d %5d %-10s %8d %8d\n", ev.time, ev.pid,
+                   eventNames[ev.type], ev.arg1, ev.arg2);
+        else
+            printf("%10d %5d %-10d %8d %8d\n", ev.time, ev.pid,
+                   ev.type, ev.arg1, ev.arg2);
+    }
+
+    if (in != stdin)
+        fclose(in);
+    return 0;
+}